@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "analyze.h"
+#include "encode.h"
+#include "types.h"
+
+/* Statistics of one band of rows */
+typedef struct _BandStats
+{
+    uint hist[ANALYZE_CHANNELS][256];
+
+    /* R_M, S_M, R_-M, S_-M, then the same on the LSB-flipped image */
+    long rs[ANALYZE_CHANNELS][8];
+} BandStats;
+
+/* Shared state of one image analysis */
+typedef struct _AnalysisJob
+{
+    const unsigned char *pixels;
+    uint width;
+    uint height;
+    uint step;          /* Bytes per pixel */
+    uint stride;        /* Bytes per row, padded to 4 */
+    int next_band;
+    pthread_mutex_t lock;
+    BandStats *bands;
+} AnalysisJob;
+
+/* Function Definitions */
+
+/* Regularised lower incomplete gamma P(a, x), series form */
+static double gamma_p_series(double a, double x)
+{
+    double sum = 1.0 / a, term = sum, ap = a;
+    for (int n = 0; n < 1000; n++)
+    {
+        ap += 1.0;
+        term *= x / ap;
+        sum += term;
+        if (fabs(term) < fabs(sum) * 1e-12)
+            break;
+    }
+    return sum * exp(-x + a * log(x) - lgamma(a));
+}
+
+/* Regularised upper incomplete gamma Q(a, x), continued fraction */
+static double gamma_q_fraction(double a, double x)
+{
+    const double tiny = 1e-300;
+    double b = x + 1.0 - a, c = 1.0 / tiny, d = 1.0 / b, h = d;
+    for (int i = 1; i < 1000; i++)
+    {
+        double an = -i * (i - a);
+        b += 2.0;
+        d = an * d + b;
+        if (fabs(d) < tiny) d = tiny;
+        c = b + an / c;
+        if (fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        double del = d * c;
+        h *= del;
+        if (fabs(del - 1.0) < 1e-12)
+            break;
+    }
+    return exp(-x + a * log(x) - lgamma(a)) * h;
+}
+
+/* Chi-square upper tail
+ * Input: Statistic and degrees of freedom
+ * Output: Probability of a statistic at least this large
+ */
+double chi_square_p_value(double chi, int dof)
+{
+    double a = dof / 2.0, x = chi / 2.0;
+    if (dof <= 0 || x <= 0)
+        return 1.0;
+    if (x < a + 1.0)
+        return 1.0 - gamma_p_series(a, x);
+    return gamma_q_fraction(a, x);
+}
+
+/* Smoothness f(G) of a group of 4 values */
+static inline int group_variation(int g0, int g1, int g2, int g3)
+{
+    return abs(g1 - g0) + abs(g2 - g1) + abs(g3 - g2);
+}
+
+/* Classify one group under M = [0 1 1 0] and -M into acc[0..3] */
+static inline void rs_classify(int g0, int g1, int g2, int g3, long *acc)
+{
+    int f = group_variation(g0, g1, g2, g3);
+
+    // F1 swaps 2k <-> 2k+1
+    int fm = group_variation(g0, g1 ^ 1, g2 ^ 1, g3);
+    // F-1 swaps 2k-1 <-> 2k
+    int fn = group_variation(g0, ((g1 + 1) ^ 1) - 1, ((g2 + 1) ^ 1) - 1, g3);
+
+    acc[0] += fm > f;
+    acc[1] += fm < f;
+    acc[2] += fn > f;
+    acc[3] += fn < f;
+}
+
+/* Analyse rows [row_begin, row_end) into one band */
+static void analyze_band(AnalysisJob *job, uint row_begin, uint row_end, BandStats *stats)
+{
+    // Four histogram banks per channel break the store-to-load
+    // dependency when neighbouring pixels share a value
+    uint banks[4][256];
+
+    for (int ch = 0; ch < ANALYZE_CHANNELS; ch++)
+    {
+        memset(banks, 0, sizeof(banks));
+        long *acc = stats->rs[ch];
+
+        for (uint y = row_begin; y < row_end; y++)
+        {
+            const unsigned char *p = job->pixels + (size_t)y * job->stride + ch;
+            uint step = job->step, x = 0;
+
+            for (; x + 4 <= job->width; x += 4)
+            {
+                int g0 = p[x * step], g1 = p[(x + 1) * step], g2 = p[(x + 2) * step], g3 = p[(x + 3) * step];
+                banks[0][g0]++;
+                banks[1][g1]++;
+                banks[2][g2]++;
+                banks[3][g3]++;
+
+                rs_classify(g0, g1, g2, g3, acc);
+                rs_classify(g0 ^ 1, g1 ^ 1, g2 ^ 1, g3 ^ 1, acc + 4);
+            }
+            for (; x < job->width; x++)
+                banks[0][p[x * step]]++;
+        }
+
+        for (int v = 0; v < 256; v++)
+            stats->hist[ch][v] = banks[0][v] + banks[1][v] + banks[2][v] + banks[3][v];
+    }
+}
+
+/* Worker thread: take bands until none are left */
+static void *analysis_worker(void *arg)
+{
+    AnalysisJob *job = arg;
+    for (;;)
+    {
+        pthread_mutex_lock(&job->lock);
+        int band = job->next_band++;
+        pthread_mutex_unlock(&job->lock);
+        if (band >= ANALYZE_BANDS)
+            break;
+
+        uint begin = (uint64_t)job->height * band / ANALYZE_BANDS;
+        uint end = (uint64_t)job->height * (band + 1) / ANALYZE_BANDS;
+        analyze_band(job, begin, end, &job->bands[band]);
+    }
+    return NULL;
+}
+
+/* Chi-square of the pairs of values in a histogram set */
+static double pov_chi_square(uint hist[ANALYZE_CHANNELS][256], int *dof)
+{
+    double chi = 0;
+    *dof = -1;
+    for (int ch = 0; ch < ANALYZE_CHANNELS; ch++)
+        for (int v = 0; v < 256; v += 2)
+        {
+            double expected = (hist[ch][v] + hist[ch][v + 1]) / 2.0;
+            // Sparse categories only add noise
+            if (expected <= 4)
+                continue;
+            double diff = hist[ch][v] - expected;
+            chi += diff * diff / expected;
+            (*dof)++;
+        }
+    return chi;
+}
+
+/* RS estimate of the changed-LSB rate from one channel's counts */
+static double rs_estimate(const long *rs)
+{
+    double d0 = rs[0] - rs[1], dn0 = rs[2] - rs[3];
+    double d1 = rs[4] - rs[5], dn1 = rs[6] - rs[7];
+    double a = 2 * (d1 + d0), b = dn0 - dn1 - d1 - 3 * d0, c = d0 - dn0;
+    double x;
+
+    if (fabs(a) < 1e-9)
+        x = fabs(b) < 1e-9 ? 0 : -c / b;
+    else
+    {
+        double disc = b * b - 4 * a * c;
+        if (disc < 0)
+            return 0;
+        double r1 = (-b + sqrt(disc)) / (2 * a), r2 = (-b - sqrt(disc)) / (2 * a);
+        x = fabs(r1) < fabs(r2) ? r1 : r2;
+    }
+
+    double p = x / (x - 0.5);
+    if (!(p > 0))
+        return 0;
+    return p > 1 ? 1 : p;
+}
+
+/* Analyse BMP
+ * Input: Image file name, thread count, result to fill
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Maps the image read-only, checks the header through the
+ * same reader as get_image_size_for_bmp, runs the band workers
+ * and combines the band statistics into the result.
+ */
+Status analyze_bmp(const char *fname, int n_threads, AnalysisResult *result)
+{
+    FILE *fptr = fopen(fname, "rb");
+    if (fptr == NULL)
+    {
+        perror("fopen");
+        return e_failure;
+    }
+
+    uint width, height, bpp, pixel_offset = 0;
+    char signature[2] = {0};
+    Status ret = e_failure;
+    if (fread(signature, 1, 2, fptr) == 2)
+        ret = read_bmp_geometry(fptr, &width, &height, &bpp);
+    if (ret == e_success && (fseek(fptr, 10, SEEK_SET) != 0 || fread(&pixel_offset, 4, 1, fptr) != 1))
+        ret = e_failure;
+
+    struct stat st;
+    if (fstat(fileno(fptr), &st) != 0)
+        ret = e_failure;
+
+    // Negative height marks a top-down BMP, row order does not matter here
+    if ((int)height < 0)
+        height = -(int)height;
+    uint stride = ((width * (bpp / 8)) + 3) & ~3u;
+    if (ret != e_success || signature[0] != 'B' || signature[1] != 'M' || (bpp != 24 && bpp != 32) ||
+        width == 0 || height == 0 || pixel_offset + (uint64_t)stride * height > (uint64_t)st.st_size)
+    {
+        printf("\033[1;36m❌ ERROR: %s is not a 24/32-bit BMP\033[0m\n", fname);
+        fclose(fptr);
+        return e_failure;
+    }
+
+    unsigned char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fptr), 0);
+    fclose(fptr);
+    if (map == MAP_FAILED)
+    {
+        perror("mmap");
+        return e_failure;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    AnalysisJob job = {0};
+    job.pixels = map + pixel_offset;
+    job.width = width;
+    job.height = height;
+    job.step = bpp / 8;
+    job.stride = stride;
+    job.bands = calloc(ANALYZE_BANDS, sizeof(BandStats));
+    pthread_mutex_init(&job.lock, NULL);
+    if (job.bands == NULL)
+    {
+        munmap(map, st.st_size);
+        return e_failure;
+    }
+
+    if (n_threads > ANALYZE_BANDS)
+        n_threads = ANALYZE_BANDS;
+    // Workers take bands until none are left, so if a thread cannot
+    // be started the ones that did (and this one) cover its bands
+    pthread_t threads[ANALYZE_BANDS];
+    int started = 1;
+    while (started < n_threads && pthread_create(&threads[started], NULL, analysis_worker, &job) == 0)
+        started++;
+    analysis_worker(&job);
+    for (int t = 1; t < started; t++)
+        pthread_join(threads[t], NULL);
+
+    // Sequential chi-square: prefix histograms in file order
+    uint prefix[ANALYZE_CHANNELS][256];
+    long rs_total[ANALYZE_CHANNELS][8] = {{0}};
+    int dof, embedded_bands = 0, run = 1;
+    memset(result, 0, sizeof(*result));
+    memset(prefix, 0, sizeof(prefix));
+
+    for (int b = 0; b < ANALYZE_BANDS; b++)
+    {
+        for (int ch = 0; ch < ANALYZE_CHANNELS; ch++)
+        {
+            for (int v = 0; v < 256; v++)
+                prefix[ch][v] += job.bands[b].hist[ch][v];
+            for (int i = 0; i < 8; i++)
+                rs_total[ch][i] += job.bands[b].rs[ch][i];
+        }
+
+        double chi = pov_chi_square(prefix, &dof);
+        double p = chi_square_p_value(chi, dof);
+        if (run && p > 0.5)
+            embedded_bands = b + 1;
+        else
+            run = 0;
+        result->chi_p_value = p;
+    }
+    result->chi_fraction = (double)embedded_bands / ANALYZE_BANDS;
+
+    for (int ch = 0; ch < ANALYZE_CHANNELS; ch++)
+    {
+        result->rs_rate[ch] = rs_estimate(rs_total[ch]);
+        result->rs_mean += result->rs_rate[ch] / ANALYZE_CHANNELS;
+    }
+    result->score = result->chi_fraction > result->rs_mean ? result->chi_fraction : result->rs_mean;
+
+    free(job.bands);
+    pthread_mutex_destroy(&job.lock);
+    munmap(map, st.st_size);
+    return e_success;
+}
+
+/* Screen images
+ * Input: argc, argv (-a <image.bmp>...)
+ * Output: Returns e_success if every image could be analysed
+ * Description: Prints one line per image with the suspicion score
+ * (0 clean .. 1 fully LSB-embedded) and the statistics behind it.
+ */
+Status do_analysis(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        printf("\033[1;36m❌ ERROR: Usage: ./a.out -a <image.bmp>...\033[0m\n");
+        return e_failure;
+    }
+
+    int n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_threads < 1)
+        n_threads = 1;
+
+    Status ret = e_success;
+    for (int i = 2; i < argc; i++)
+    {
+        AnalysisResult r;
+        if (analyze_bmp(argv[i], n_threads, &r) != e_success)
+        {
+            ret = e_failure;
+            continue;
+        }
+        printf("%s: score %.2f  chi-square p=%.3f embedded-prefix %.0f%%  RS rate B %.3f G %.3f R %.3f\n",
+               argv[i], r.score, r.chi_p_value, r.chi_fraction * 100, r.rs_rate[0], r.rs_rate[1], r.rs_rate[2]);
+    }
+    return ret;
+}
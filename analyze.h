@@ -0,0 +1,45 @@
+#ifndef ANALYZE_H
+#define ANALYZE_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * LSB steganalysis for screening arbitrary 24/32-bit BMPs.
+ *
+ * The pixel rows are cut into ANALYZE_BANDS bands in file order,
+ * worker threads take bands off a shared counter and compute for
+ * each band and colour channel:
+ *  - the value histogram (pairs of values 2k / 2k+1 feed the
+ *    chi-square attack), and
+ *  - RS counts: regular / singular groups of 4 pixels under the
+ *    mask [0 1 1 0] and its negation, on the image and on the
+ *    image with every LSB flipped (Fridrich's RS analysis).
+ * Prefix sums over bands give the sequential chi-square curve
+ * (how far into the file the histogram pairs look equalised).
+ */
+
+#define ANALYZE_BANDS 32
+#define ANALYZE_CHANNELS 3
+
+typedef struct _AnalysisResult
+{
+    double chi_p_value;         /* Chi-square p-value over the whole image */
+    double chi_fraction;        /* Longest prefix with p > 0.5, 0..1 */
+    double rs_rate[ANALYZE_CHANNELS];  /* RS estimate of changed LSB rate per channel (B, G, R) */
+    double rs_mean;
+    double score;               /* Suspicion score 0..1 */
+} AnalysisResult;
+
+
+/* Analysis function prototype */
+
+/* Screen images: -a <image.bmp>... */
+Status do_analysis(int argc, char *argv[]);
+
+/* Analyse one BMP with n_threads worker threads */
+Status analyze_bmp(const char *fname, int n_threads, AnalysisResult *result);
+
+/* Upper tail of the chi-square distribution with dof degrees of freedom */
+double chi_square_p_value(double chi, int dof);
+
+#endif
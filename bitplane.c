@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "bitplane.h"
+#include "encode.h"
+#include "stego_header.h"
+#include "types.h"
+
+/* Function Definitions */
+
+/* Expand bytes into one 0/1 byte per bit, most significant bit first */
+static void expand_bits(const unsigned char *data, long size, unsigned char *plane)
+{
+    for (long i = 0; i < size; i++)
+        for (int b = 0; b < 8; b++)
+            plane[i * 8 + b] = (data[i] >> (7 - b)) & 1;
+}
+
+/* Build payload bitplane
+ * Input: Secret file name and bitplane to fill
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Reads the secret once, builds the same v2 header do_encoding
+ * writes and expands header + data into the plane, so every
+ * carrier stamped from it decodes with the normal -d path.
+ */
+Status build_payload_bitplane(const char *secret_fname, Bitplane *bp)
+{
+    memset(bp, 0, sizeof(*bp));
+
+    // Same extension rule as read_and_validate_encode_args
+    const char *dot = strchr(secret_fname, '.');
+    if (dot == NULL || strlen(dot) >= MAX_FILE_SUFFIX_)
+        return e_failure;
+    strcpy(bp->extn_secret_file, dot);
+
+    FILE *fptr = fopen(secret_fname, "rb");
+    if (fptr == NULL)
+    {
+        perror("fopen");
+        return e_failure;
+    }
+    bp->size_secret_file = get_file_size(fptr);
+
+    StegoHeader hdr = {0};
+    unsigned char header[STEGO_HEADER_MAX];
+    hdr.version = STEGO_HEADER_V2;
+    strcpy(hdr.extn_secret_file, bp->extn_secret_file);
+    hdr.size_secret_file = bp->size_secret_file;
+    uint header_len = build_stego_header(&hdr, header);
+
+    unsigned char *data = malloc(bp->size_secret_file + 1);
+    bp->length = (header_len + bp->size_secret_file) * 8;
+    bp->plane = malloc(bp->length);
+    if (!data || !bp->plane || fread(data, 1, bp->size_secret_file, fptr) != (size_t)bp->size_secret_file)
+    {
+        fclose(fptr);
+        free(data);
+        free_payload_bitplane(bp);
+        return e_failure;
+    }
+    fclose(fptr);
+
+    expand_bits(header, header_len, bp->plane);
+    expand_bits(data, bp->size_secret_file, bp->plane + header_len * 8);
+    free(data);
+
+    printf("\033[1;36m🧬 Payload expanded once: %ld secret bytes -> %ld plane bytes.\033[0m\n", bp->size_secret_file, bp->length);
+    return e_success;
+}
+
+/* Blend bitplane
+ * Input: Carrier bytes, plane bytes, length
+ * Output: Carrier bytes with their LSBs replaced by the plane
+ * Description: 16 bytes per step with SSE2, scalar for the tail.
+ */
+void blend_bitplane(unsigned char *carrier, const unsigned char *plane, long len)
+{
+    long i = 0;
+#ifdef __SSE2__
+    const __m128i keep = _mm_set1_epi8((char)0xFE);
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i *)(carrier + i));
+        __m128i p = _mm_loadu_si128((const __m128i *)(plane + i));
+        _mm_storeu_si128((__m128i *)(carrier + i), _mm_or_si128(_mm_and_si128(c, keep), p));
+    }
+#endif
+    for (; i < len; i++)
+        carrier[i] = (carrier[i] & 0xFE) | plane[i];
+}
+
+/* Stamp carrier
+ * Input: Bitplane, options (--raw geometry), source carrier and
+ *        output file names
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Probes the carrier like -e does, copies its format header, streams
+ * the span through blend_bitplane in BITPLANE_CHUNK pieces and copies
+ * the rest of the image. The output is written as "<name>.part" and
+ * renamed into place only when complete.
+ */
+Status stamp_carrier(const Bitplane *bp, const StegoOptions *opts, const char *src_fname, const char *stego_fname)
+{
+    CarrierInfo carrier = {0};
+    if (carrier_format_from_name(src_fname, opts, &carrier.format) != e_success)
+    {
+        printf("\033[1;36m❌ ERROR: %s is not a .bmp, .ppm, .pam or --raw carrier\033[0m\n", src_fname);
+        return e_failure;
+    }
+
+    FILE *fptr_src = fopen(src_fname, "rb");
+    if (fptr_src == NULL)
+    {
+        perror("fopen");
+        return e_failure;
+    }
+
+    if (probe_carrier(fptr_src, opts, &carrier) != e_success || get_usable_capacity(&carrier, opts) < bp->length)
+    {
+        printf("\033[1;36m❌ ERROR: %s cannot hold the payload\033[0m\n", src_fname);
+        fclose(fptr_src);
+        return e_failure;
+    }
+
+    Checkpoint ckpt;
+    checkpoint_init(&ckpt, stego_fname);
+    FILE *fptr_stego = checkpoint_open_output(&ckpt, 0);
+    unsigned char *buffer = malloc(BITPLANE_CHUNK);
+    Status ret = (fptr_stego && buffer) ? e_success : e_failure;
+    if (ret == e_success)
+        ret = copy_carrier_header(fptr_src, fptr_stego, &carrier);
+
+    for (long done = 0; ret == e_success && done < bp->length; )
+    {
+        size_t n = bp->length - done < BITPLANE_CHUNK ? bp->length - done : BITPLANE_CHUNK;
+        if (fread(buffer, 1, n, fptr_src) != n)
+            ret = e_failure;
+        else
+        {
+            blend_bitplane(buffer, bp->plane + done, n);
+            if (fwrite(buffer, 1, n, fptr_stego) != n)
+                ret = e_failure;
+        }
+        done += n;
+    }
+
+    if (ret == e_success)
+        ret = copy_remaining_img_data(fptr_src, fptr_stego);
+    if (ret == e_success)
+        ret = checkpoint_commit(&ckpt, fptr_stego);
+    if (ret != e_success)
+        checkpoint_abort(&ckpt);
+
+    free(buffer);
+    fclose(fptr_src);
+    if (fptr_stego)
+        fclose(fptr_stego);
+    return ret;
+}
+
+/* Free payload bitplane */
+void free_payload_bitplane(Bitplane *bp)
+{
+    free(bp->plane);
+    bp->plane = NULL;
+    bp->length = 0;
+}
+
+/* Watermark many carriers
+ * Input: argc, argv (-w <secret_file> <output_dir> <carrier>... [--raw=...])
+ * Output: Returns e_success if every carrier was stamped
+ * Description:
+ * Builds the bitplane once, then stamps each carrier into
+ * <output_dir>/<carrier name>. Failures are reported per carrier.
+ */
+Status do_watermark(int argc, char *argv[])
+{
+    StegoOptions opts = {0};
+    if (parse_stego_options(&argc, argv, &opts) != e_success)
+        return e_failure;
+    if (argc < 5 || (opts.flags & ~OPT_RAW))
+    {
+        printf("\033[1;36m❌ ERROR: Usage: ./a.out -w <secret_file> <output_dir> <carrier>... [--raw=WxH[xC][:stride]]\033[0m\n");
+        return e_failure;
+    }
+
+    Bitplane bp;
+    if (build_payload_bitplane(argv[2], &bp) != e_success)
+    {
+        printf("\033[1;36m❌ ERROR: Unable to prepare payload %s\033[0m\n", argv[2]);
+        return e_failure;
+    }
+
+    Status ret = e_success;
+    int stamped = 0;
+    for (int i = 4; i < argc; i++)
+    {
+        const char *base = strrchr(argv[i], '/');
+        base = base ? base + 1 : argv[i];
+
+        char stego_fname[2048];
+        snprintf(stego_fname, sizeof(stego_fname), "%s/%s", argv[3], base);
+
+        // Never write over the carrier being read
+        char src_real[PATH_MAX], dst_real[PATH_MAX];
+        if (realpath(argv[i], src_real) && realpath(stego_fname, dst_real) && strcmp(src_real, dst_real) == 0)
+        {
+            printf("\033[1;36m❌ ERROR: Output for %s would overwrite it\033[0m\n", argv[i]);
+            ret = e_failure;
+            continue;
+        }
+
+        if (stamp_carrier(&bp, &opts, argv[i], stego_fname) != e_success)
+        {
+            printf("\033[1;36m❌ ERROR: Failed to stamp %s\033[0m\n", argv[i]);
+            ret = e_failure;
+        }
+        else
+            stamped++;
+    }
+
+    printf("\033[1;36m🏆 Stamped %d of %d carriers.\033[0m\n", stamped, argc - 4);
+    free_payload_bitplane(&bp);
+    return ret;
+}
@@ -0,0 +1,42 @@
+#ifndef BITPLANE_H
+#define BITPLANE_H
+
+#include "types.h"  // Contains user defined types
+#include "decode.h" // For MAX_FILE_SUFFIX_, options and carrier formats
+
+/*
+ * Expanded payload bitplane.
+ * The header and secret are expanded once into one byte per
+ * payload bit (0 or 1). Stamping a carrier is then a single
+ * masked blend over the span: stego = (carrier & ~1) | plane.
+ */
+
+#define BITPLANE_CHUNK (1024 * 1024)
+
+typedef struct _Bitplane
+{
+    unsigned char *plane;   /* One byte (0/1) per payload bit */
+    long length;            /* Carrier bytes covered by plane */
+    char extn_secret_file[MAX_FILE_SUFFIX_];
+    long size_secret_file;
+} Bitplane;
+
+
+/* Bitplane function prototype */
+
+/* Stamp one secret into many carriers: -w <secret_file> <output_dir> <carrier>... [--raw=...] */
+Status do_watermark(int argc, char *argv[]);
+
+/* Read the secret once and expand header + data into a bitplane */
+Status build_payload_bitplane(const char *secret_fname, Bitplane *bp);
+
+/* carrier[i] = (carrier[i] & ~1) | plane[i] over len bytes */
+void blend_bitplane(unsigned char *carrier, const unsigned char *plane, long len);
+
+/* Write stego_fname = src_fname with the bitplane blended in */
+Status stamp_carrier(const Bitplane *bp, const StegoOptions *opts, const char *src_fname, const char *stego_fname);
+
+/* Release bitplane memory */
+void free_payload_bitplane(Bitplane *bp);
+
+#endif
@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <sys/stat.h>
+#include "carrier.h"
+#include "encode.h"
+#include "stego_header.h"
+#include "types.h"
+
+/* Header layer of one carrier format */
+typedef struct _CarrierHandler
+{
+    CarrierFormat format;
+    const char *extn;
+    const char *stego_name;
+    Status (*probe)(FILE *fptr_image, const StegoOptions *opts, CarrierInfo *carrier);
+} CarrierHandler;
+
+static Status probe_bmp(FILE *fptr_image, const StegoOptions *opts, CarrierInfo *carrier);
+static Status probe_ppm(FILE *fptr_image, const StegoOptions *opts, CarrierInfo *carrier);
+static Status probe_pam(FILE *fptr_image, const StegoOptions *opts, CarrierInfo *carrier);
+static Status probe_raw(FILE *fptr_image, const StegoOptions *opts, CarrierInfo *carrier);
+
+/* Indexed by CarrierFormat */
+static const CarrierHandler carrier_handlers[] =
+{
+    { e_carrier_bmp, ".bmp", "stego.bmp", probe_bmp },
+    { e_carrier_ppm, ".ppm", "stego.ppm", probe_ppm },
+    { e_carrier_pam, ".pam", "stego.pam", probe_pam },
+    { e_carrier_raw, ".raw", "stego.raw", probe_raw },
+};
+
+#define CARRIER_HANDLERS (sizeof(carrier_handlers) / sizeof(carrier_handlers[0]))
+
+/* Function Definitions */
+
+/* Carrier format from name
+ * Input: File name, options, format to fill
+ * Output: Returns e_success if the extension is a known carrier
+ * Description: --raw makes any file a headerless carrier, otherwise
+ * the extension picks the header layer.
+ */
+Status carrier_format_from_name(const char *fname, const StegoOptions *opts, CarrierFormat *format)
+{
+    if (opts->flags & OPT_RAW)
+    {
+        *format = e_carrier_raw;
+        return e_success;
+    }
+
+    int len = strlen(fname);
+    for (uint i = 0; i < CARRIER_HANDLERS; i++)
+    {
+        int extn_len = strlen(carrier_handlers[i].extn);
+        if (len > extn_len && strcmp(fname + len - extn_len, carrier_handlers[i].extn) == 0)
+        {
+            *format = carrier_handlers[i].format;
+            return e_success;
+        }
+    }
+    return e_failure;
+}
+
+/* File name extension of a carrier format */
+const char *carrier_format_extn(CarrierFormat format)
+{
+    return carrier_handlers[format].extn;
+}
+
+/* Default stego output name of a carrier format */
+const char *carrier_default_stego_name(CarrierFormat format)
+{
+    return carrier_handlers[format].stego_name;
+}
+
+/* BMP: pixels at bfOffBits (54, or 122/138 after a V4/V5 header), capacity as before */
+static Status probe_bmp(FILE *fptr_image, const StegoOptions *opts, CarrierInfo *carrier)
+{
+    (void)opts;
+    uint bpp, pixel_offset;
+    if (read_bmp_geometry(fptr_image, &carrier->width, &carrier->height, &bpp) != e_success)
+        return e_failure;
+
+    // bfOffBits: 4 bytes at offset 10, never inside the 54-byte header
+    if (fseek(fptr_image, 10, SEEK_SET) != 0 || fread(&pixel_offset, 4, 1, fptr_image) != 1 ||
+        pixel_offset < BMP_HEADER_SIZE)
+        return e_failure;
+
+    // 32-bit pixels keep the 24-bit capacity rule (alpha is not counted)
+    carrier->channels = 3;
+    carrier->bytes_per_pixel = bpp / 8;
+    carrier->stride = ((carrier->width * (bpp / 8)) + 3) & ~3u;
+    carrier->pixel_offset = pixel_offset;
+    return e_success;
+}
+
+/* Read one PNM header token, skipping white space and comments */
+static Status read_pnm_token(FILE *fptr_image, char *token, int size)
+{
+    int c = fgetc(fptr_image), n = 0;
+
+    // White space and "#" comments up to the end of the line
+    while (c != EOF && (isspace(c) || c == '#'))
+    {
+        if (c == '#')
+            while (c != EOF && c != '\n')
+                c = fgetc(fptr_image);
+        c = fgetc(fptr_image);
+    }
+
+    while (c != EOF && !isspace(c) && n < size - 1)
+    {
+        token[n++] = c;
+        c = fgetc(fptr_image);
+    }
+    token[n] = '\0';
+
+    // The single white space after the last field ends the header
+    return n > 0 && c != EOF && isspace(c) ? e_success : e_failure;
+}
+
+/* PPM (P6): magic, width, height, maxval, one white space */
+static Status probe_ppm(FILE *fptr_image, const StegoOptions *opts, CarrierInfo *carrier)
+{
+    (void)opts;
+    char token[16];
+    long value[3];
+
+    if (fseek(fptr_image, 0, SEEK_SET) != 0)
+        return e_failure;
+    if (read_pnm_token(fptr_image, token, sizeof(token)) != e_success || strcmp(token, "P6") != 0)
+        return e_failure;
+    for (int i = 0; i < 3; i++)
+    {
+        if (read_pnm_token(fptr_image, token, sizeof(token)) != e_success)
+            return e_failure;
+        value[i] = atol(token);
+    }
+
+    // 16-bit samples would put the payload in the high bytes
+    if (value[0] <= 0 || value[1] <= 0 || value[2] <= 0 || value[2] > 255)
+        return e_failure;
+
+    carrier->width = value[0];
+    carrier->height = value[1];
+    carrier->channels = 3;
+    carrier->bytes_per_pixel = 3;
+    carrier->stride = carrier->width * 3;
+    carrier->pixel_offset = ftell(fptr_image);
+    return e_success;
+}
+
+/* PAM (P7): "KEY value" lines up to ENDHDR */
+static Status probe_pam(FILE *fptr_image, const StegoOptions *opts, CarrierInfo *carrier)
+{
+    (void)opts;
+    char line[128], key[16];
+    long value, width = 0, height = 0, depth = 0, maxval = 0;
+
+    if (fseek(fptr_image, 0, SEEK_SET) != 0)
+        return e_failure;
+    if (fgets(line, sizeof(line), fptr_image) == NULL || strcmp(line, "P7\n") != 0)
+        return e_failure;
+
+    for (;;)
+    {
+        if (fgets(line, sizeof(line), fptr_image) == NULL)
+            return e_failure;
+        if (strcmp(line, "ENDHDR\n") == 0)
+            break;
+        if (line[0] == '#' || sscanf(line, "%15s %ld", key, &value) != 2)
+            continue;   // Comments and TUPLTYPE
+
+        if (strcmp(key, "WIDTH") == 0)
+            width = value;
+        else if (strcmp(key, "HEIGHT") == 0)
+            height = value;
+        else if (strcmp(key, "DEPTH") == 0)
+            depth = value;
+        else if (strcmp(key, "MAXVAL") == 0)
+            maxval = value;
+    }
+
+    if (width <= 0 || height <= 0 || depth <= 0 || maxval <= 0 || maxval > 255)
+        return e_failure;
+
+    carrier->width = width;
+    carrier->height = height;
+    carrier->channels = depth;
+    carrier->bytes_per_pixel = depth;
+    carrier->stride = width * depth;
+    carrier->pixel_offset = ftell(fptr_image);
+    return e_success;
+}
+
+/* Raw: no header, geometry from --raw. Decoding needs none,
+ * the embedded header says how much to read. */
+static Status probe_raw(FILE *fptr_image, const StegoOptions *opts, CarrierInfo *carrier)
+{
+    carrier->pixel_offset = 0;
+    if (!(opts->flags & OPT_RAW))
+    {
+        struct stat st;
+        if (fstat(fileno(fptr_image), &st) != 0)
+            return e_failure;
+        carrier->width = st.st_size;
+        carrier->height = 1;
+        carrier->channels = 1;
+        carrier->bytes_per_pixel = 1;
+        carrier->stride = st.st_size;
+        return e_success;
+    }
+
+    carrier->width = opts->raw_width;
+    carrier->height = opts->raw_height;
+    carrier->channels = opts->raw_channels;
+    carrier->bytes_per_pixel = opts->raw_channels;
+    carrier->stride = opts->raw_stride ? opts->raw_stride : opts->raw_width * opts->raw_channels;
+    if (carrier->stride < carrier->width * carrier->channels)
+    {
+        printf("\033[1;36m❌ ERROR: Raw stride %u is shorter than a row\033[0m\n", carrier->stride);
+        return e_failure;
+    }
+    return e_success;
+}
+
+/* Probe carrier
+ * Input: Carrier file ptr (format already set), options, CarrierInfo
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Runs the header layer of the format, then checks that the file
+ * really holds the pixel rows the header promises and sets the
+ * capacity. BMP rows are all padded to the stride, so a BMP must
+ * hold stride * height bytes after its pixel offset.
+ */
+Status probe_carrier(FILE *fptr_image, const StegoOptions *opts, CarrierInfo *carrier)
+{
+    if (carrier_handlers[carrier->format].probe(fptr_image, opts, carrier) != e_success)
+    {
+        printf("\033[1;36m❌ ERROR: Invalid %s carrier header\033[0m\n", carrier_format_extn(carrier->format));
+        return e_failure;
+    }
+
+    // Rows are stride apart, the last one only needs its pixels
+    unsigned long long need = (unsigned long long)carrier->stride * (carrier->height - 1) +
+                              (unsigned long long)carrier->width * carrier->channels;
+    if (carrier->format == e_carrier_bmp)
+        need = (unsigned long long)carrier->stride * carrier->height;
+    struct stat st;
+    if (fstat(fileno(fptr_image), &st) != 0 || carrier->pixel_offset + need > (unsigned long long)st.st_size)
+    {
+        printf("\033[1;36m❌ ERROR: Carrier is shorter than its %u x %u pixels\033[0m\n", carrier->width, carrier->height);
+        return e_failure;
+    }
+    carrier->capacity = (long long)carrier->width * carrier->height * carrier->channels;
+    return e_success;
+}
+
+/* Copy carrier header
+ * Input: Source and destination file ptrs, probed carrier
+ * Output: Returns e_success or e_failure
+ * Description: The pixel_offset bytes in front of the pixels are
+ * copied as they are (nothing for raw buffers).
+ */
+Status copy_carrier_header(FILE *fptr_src_image, FILE *fptr_dest_image, const CarrierInfo *carrier)
+{
+    char buffer[4096];
+    long left = carrier->pixel_offset;
+
+    if (fseek(fptr_src_image, 0, SEEK_SET) != 0)
+        return e_failure;
+
+    while (left > 0)
+    {
+        size_t n = left < (long)sizeof(buffer) ? (size_t)left : sizeof(buffer);
+        if (fread(buffer, 1, n, fptr_src_image) != n || fwrite(buffer, 1, n, fptr_dest_image) != n)
+            return e_failure;
+        left -= n;
+    }
+    return e_success;
+}
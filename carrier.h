@@ -0,0 +1,64 @@
+#ifndef CARRIER_H
+#define CARRIER_H
+
+#include <stdio.h>
+#include "types.h"   // Contains user defined types
+#include "options.h" // For the --raw geometry
+
+/*
+ * Carrier formats. Only the header in front of the pixel bytes
+ * differs between them; the embedded header and payload are
+ * written to the pixel bytes the same way for every format.
+ *
+ *   .bmp  BMP header; pixels from bfOffBits (54, or more for V4/V5)
+ *   .ppm  binary PPM (P6), maxval <= 255
+ *   .pam  PAM (P7), any DEPTH, maxval <= 255
+ *   .raw  headerless pixel buffer, geometry from --raw=WxH[xC][:stride]
+ *
+ * The pixel bytes are used as one stream, the capacity rule is
+ * width * height * bytes per pixel for every format.
+ */
+
+typedef enum
+{
+    e_carrier_bmp,
+    e_carrier_ppm,
+    e_carrier_pam,
+    e_carrier_raw
+} CarrierFormat;
+
+typedef struct _CarrierInfo
+{
+    CarrierFormat format;
+    uint width;
+    uint height;
+    uint channels;      /* Bytes per pixel counted by the capacity rule */
+    uint bytes_per_pixel;
+    uint stride;        /* Bytes per row */
+
+    /* Size of the format header, the pixel bytes start here */
+    long pixel_offset;
+
+    /* Pixel bytes available for embedding, may exceed 4 GiB */
+    long long capacity;
+} CarrierInfo;
+
+
+/* Carrier function prototype */
+
+/* Pick the carrier format from the file name (any name with --raw) */
+Status carrier_format_from_name(const char *fname, const StegoOptions *opts, CarrierFormat *format);
+
+/* File name extension written for a format */
+const char *carrier_format_extn(CarrierFormat format);
+
+/* Default stego output name for a format */
+const char *carrier_default_stego_name(CarrierFormat format);
+
+/* Parse the format header, fill geometry, pixel offset and capacity */
+Status probe_carrier(FILE *fptr_image, const StegoOptions *opts, CarrierInfo *carrier);
+
+/* Copy the format header unchanged, leaves both files at the pixel bytes */
+Status copy_carrier_header(FILE *fptr_src_image, FILE *fptr_dest_image, const CarrierInfo *carrier);
+
+#endif
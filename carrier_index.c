@@ -0,0 +1,468 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "carrier_index.h"
+#include "encode.h"
+#include "types.h"
+
+/* Function Definitions */
+
+/* Compare two index entries by path (qsort / bsearch helper) */
+static int compare_entry_path(const void *a, const void *b)
+{
+    return strcmp(((const CarrierEntry *)a)->path, ((const CarrierEntry *)b)->path);
+}
+
+/* Append an entry
+ * Input: Index and entry to copy
+ * Output: Returns e_success or e_failure on allocation error
+ * Description: Grows the entry array geometrically.
+ */
+static Status append_carrier_entry(CarrierIndex *index, const CarrierEntry *entry)
+{
+    if (index->count == index->alloc)
+    {
+        uint alloc = index->alloc ? index->alloc * 2 : 64;
+        CarrierEntry *entries = realloc(index->entries, alloc * sizeof(CarrierEntry));
+        if (entries == NULL)
+            return e_failure;
+        index->entries = entries;
+        index->alloc = alloc;
+    }
+    index->entries[index->count++] = *entry;
+    return e_success;
+}
+
+/* Read carrier header
+ * Input: Carrier path, entry to fill (size already set)
+ * Output: Returns e_success if the file is a usable carrier
+ * Description:
+ * Probes the carrier like the encoder does, which reads only the
+ * format header, so indexing a library never touches pixel data.
+ */
+static Status read_carrier_entry(const char *path, CarrierEntry *entry)
+{
+    StegoOptions opts = {0};
+    CarrierInfo carrier = {0};
+
+    if (carrier_format_from_name(path, &opts, &carrier.format) != e_success)
+        return e_failure;
+
+    FILE *fptr = fopen(path, "rb");
+    if (fptr == NULL)
+        return e_failure;
+
+    // The pixel rows must fit in the size the entry records, or -p
+    // would plan for a carrier -e rejects
+    Status ret = probe_carrier(fptr, &opts, &carrier);
+    if (ret == e_success && carrier.pixel_offset + (long long)carrier.stride * carrier.height > entry->size)
+        ret = e_failure;
+    if (ret == e_success)
+    {
+        entry->width = carrier.width;
+        entry->height = carrier.height;
+        entry->bytes_per_pixel = carrier.bytes_per_pixel;
+        entry->stride = carrier.stride;
+        entry->capacity = carrier.capacity;
+    }
+    fclose(fptr);
+    return ret;
+}
+
+/* Carrier of an entry, as far as the capacity rules need it */
+static void entry_carrier(const CarrierEntry *entry, CarrierInfo *carrier)
+{
+    memset(carrier, 0, sizeof(*carrier));
+    carrier->width = entry->width;
+    carrier->height = entry->height;
+    carrier->bytes_per_pixel = entry->bytes_per_pixel;
+    carrier->stride = entry->stride;
+    carrier->capacity = entry->capacity;
+}
+
+/* Load carrier index
+ * Input: Index file name and index structure
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Each line holds "capacity width height bytes_per_pixel stride
+ * size mtime path". A missing index file, or one written by an
+ * older version, is treated as an empty library.
+ */
+Status load_carrier_index(const char *index_fname, CarrierIndex *index)
+{
+    memset(index, 0, sizeof(*index));
+
+    FILE *fptr = fopen(index_fname, "r");
+    if (fptr == NULL)
+        return e_success;
+
+    char line[MAX_CARRIER_PATH + 128];
+    if (fgets(line, sizeof(line), fptr) != NULL && strncmp(line, CARRIER_INDEX_MAGIC_V1, strlen(CARRIER_INDEX_MAGIC_V1)) == 0)
+    {
+        // No pixel layout recorded: every carrier is probed again
+        fclose(fptr);
+        return e_success;
+    }
+    if (ferror(fptr) || strncmp(line, CARRIER_INDEX_MAGIC, strlen(CARRIER_INDEX_MAGIC)) != 0)
+    {
+        printf("\033[1;36m❌ ERROR: %s is not a carrier index\033[0m\n", index_fname);
+        fclose(fptr);
+        return e_failure;
+    }
+
+    while (fgets(line, sizeof(line), fptr) != NULL)
+    {
+        CarrierEntry entry = {0};
+        int consumed = 0;
+        if (sscanf(line, "%lld %u %u %u %u %ld %ld %n", &entry.capacity, &entry.width, &entry.height,
+                   &entry.bytes_per_pixel, &entry.stride, &entry.size, &entry.mtime, &consumed) != 7 || consumed == 0)
+            continue;
+
+        // Path is the rest of the line, so it may contain spaces
+        line[strcspn(line, "\n")] = '\0';
+        strncpy(entry.path, line + consumed, MAX_CARRIER_PATH - 1);
+        if (append_carrier_entry(index, &entry) != e_success)
+        {
+            fclose(fptr);
+            return e_failure;
+        }
+    }
+    fclose(fptr);
+
+    qsort(index->entries, index->count, sizeof(CarrierEntry), compare_entry_path);
+    return e_success;
+}
+
+/* Save carrier index
+ * Input: Index file name and index structure
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Writes to "<index>.tmp" first and renames it over the old index,
+ * so a concurrent reader never sees a half-written file.
+ */
+Status save_carrier_index(const char *index_fname, CarrierIndex *index)
+{
+    char tmp_fname[MAX_CARRIER_PATH + 8];
+    snprintf(tmp_fname, sizeof(tmp_fname), "%s.tmp", index_fname);
+
+    FILE *fptr = fopen(tmp_fname, "w");
+    if (fptr == NULL)
+    {
+        perror("fopen");
+        return e_failure;
+    }
+
+    fprintf(fptr, "%s\n", CARRIER_INDEX_MAGIC);
+    for (uint i = 0; i < index->count; i++)
+    {
+        CarrierEntry *e = &index->entries[i];
+        fprintf(fptr, "%lld %u %u %u %u %ld %ld %s\n", e->capacity, e->width, e->height, e->bytes_per_pixel,
+                e->stride, e->size, e->mtime, e->path);
+    }
+
+    if (fclose(fptr) != 0 || rename(tmp_fname, index_fname) != 0)
+    {
+        perror("rename");
+        return e_failure;
+    }
+    return e_success;
+}
+
+/* Refresh carrier index
+ * Input: Index (sorted by path) and carrier directory
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Scans the directory for .bmp, .ppm and .pam files. Entries whose size and mtime
+ * are unchanged are kept as is; only new or modified carriers have
+ * their header re-read. Entries for files that disappeared from the
+ * directory are dropped, entries from other directories are kept.
+ */
+Status refresh_carrier_index(CarrierIndex *index, const char *carrier_dir)
+{
+    DIR *dir = opendir(carrier_dir);
+    if (dir == NULL)
+    {
+        perror("opendir");
+        return e_failure;
+    }
+
+    uint old_count = index->count;
+    char *seen = calloc(old_count + 1, 1);
+    if (seen == NULL)
+    {
+        closedir(dir);
+        return e_failure;
+    }
+
+    uint reused = 0, scanned = 0;
+    struct dirent *dent;
+    while ((dent = readdir(dir)) != NULL)
+    {
+        StegoOptions no_opts = {0};
+        CarrierFormat format;
+        if (carrier_format_from_name(dent->d_name, &no_opts, &format) != e_success || format == e_carrier_raw)
+            continue;
+
+        CarrierEntry entry = {0};
+        snprintf(entry.path, sizeof(entry.path), "%s/%s", carrier_dir, dent->d_name);
+
+        struct stat st;
+        if (stat(entry.path, &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        entry.size = st.st_size;
+        entry.mtime = st.st_mtime;
+
+        // Old entries are sorted, new ones are appended after old_count
+        CarrierEntry *found = bsearch(&entry, index->entries, old_count, sizeof(CarrierEntry), compare_entry_path);
+        if (found != NULL)
+        {
+            seen[found - index->entries] = 1;
+            if (found->size == entry.size && found->mtime == entry.mtime)
+            {
+                reused++;
+                continue;
+            }
+        }
+
+        scanned++;
+        if (read_carrier_entry(entry.path, &entry) != e_success)
+        {
+            // Carrier changed into something unusable, drop it
+            if (found != NULL)
+                seen[found - index->entries] = 0;
+            continue;
+        }
+
+        if (found != NULL)
+            *found = entry;
+        else if (append_carrier_entry(index, &entry) != e_success)
+        {
+            free(seen);
+            closedir(dir);
+            return e_failure;
+        }
+    }
+    closedir(dir);
+
+    // Compact out vanished entries that belonged to this directory
+    int dir_len = strlen(carrier_dir);
+    uint kept = 0;
+    for (uint i = 0; i < index->count; i++)
+    {
+        CarrierEntry *e = &index->entries[i];
+        int in_dir = strncmp(e->path, carrier_dir, dir_len) == 0 && e->path[dir_len] == '/' &&
+                     strchr(e->path + dir_len + 1, '/') == NULL;
+        if (i < old_count && in_dir && !seen[i])
+            continue;
+        index->entries[kept++] = *e;
+    }
+    index->count = kept;
+    free(seen);
+
+    qsort(index->entries, index->count, sizeof(CarrierEntry), compare_entry_path);
+
+    printf("\033[1;36m📚 Indexed %u carriers (%u reused, %u headers read).\033[0m\n", index->count, reused, scanned);
+    return e_success;
+}
+
+/* Planner sort state: qsort has no context argument */
+static long long *plan_capacity;
+static long long *plan_need;
+
+/* Order carriers by ascending capacity */
+static int compare_carrier_capacity(const void *a, const void *b)
+{
+    long long ca = plan_capacity[*(const int *)a];
+    long long cb = plan_capacity[*(const int *)b];
+    return (ca > cb) - (ca < cb);
+}
+
+/* Order secrets by descending need */
+static int compare_secret_need(const void *a, const void *b)
+{
+    long long na = plan_need[*(const int *)a];
+    long long nb = plan_need[*(const int *)b];
+    return (na < nb) - (na > nb);
+}
+
+/* Find next unassigned slot at or after i (path-compressed) */
+static int next_free_slot(int *next, int i)
+{
+    int root = i;
+    while (next[root] != root)
+        root = next[root];
+    while (next[i] != root)
+    {
+        int up = next[i];
+        next[i] = root;
+        i = up;
+    }
+    return root;
+}
+
+/* Plan carrier assignment
+ * Input: Index, secret file names, number of secrets, encode options,
+ * assignment array
+ * Output: assignment[i] is the index entry for secret i, or -1
+ * Description:
+ * Best-fit decreasing: the largest secrets are placed first, each into
+ * the smallest free carrier whose capacity is large enough. Need and
+ * capacity come from the encoder's own rules for the given options.
+ * Each carrier holds at most one secret.
+ */
+Status plan_carrier_assignment(CarrierIndex *index, char *secret_fnames[], int n_secrets, const StegoOptions *opts,
+                               int *assignment)
+{
+    int n_carriers = index->count;
+    int *carrier_order = malloc((n_carriers + 1) * sizeof(int));
+    int *next = malloc((n_carriers + 1) * sizeof(int));
+    int *secret_order = malloc(n_secrets * sizeof(int));
+    long long *need = malloc(n_secrets * sizeof(long long));
+    long long *capacity = malloc((n_carriers + 1) * sizeof(long long));
+    if (!carrier_order || !next || !secret_order || !need || !capacity)
+    {
+        free(carrier_order); free(next); free(secret_order); free(need); free(capacity);
+        return e_failure;
+    }
+
+    for (int i = 0; i < n_secrets; i++)
+    {
+        struct stat st;
+        char *dot = strchr(secret_fnames[i], '.');
+        secret_order[i] = i;
+        assignment[i] = -1;
+        need[i] = dot != NULL && stat(secret_fnames[i], &st) == 0 ? get_required_capacity(dot, st.st_size, opts) : 0;
+        if (need[i] == 0)
+            need[i] = -1;
+    }
+
+    // next[] points at the next free position in capacity order,
+    // position n_carriers is a sentinel meaning "none left"
+    for (int i = 0; i <= n_carriers; i++)
+    {
+        carrier_order[i] = i;
+        next[i] = i;
+    }
+    for (int i = 0; i < n_carriers; i++)
+    {
+        CarrierInfo carrier;
+        entry_carrier(&index->entries[i], &carrier);
+        capacity[i] = get_usable_capacity(&carrier, opts);
+    }
+
+    plan_capacity = capacity;
+    plan_need = need;
+    qsort(carrier_order, n_carriers, sizeof(int), compare_carrier_capacity);
+    qsort(secret_order, n_secrets, sizeof(int), compare_secret_need);
+
+    for (int s = 0; s < n_secrets; s++)
+    {
+        int secret = secret_order[s];
+        if (need[secret] < 0)
+            continue;
+
+        // Lower bound: first carrier in capacity order that fits
+        int lo = 0, hi = n_carriers;
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if (capacity[carrier_order[mid]] < need[secret])
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        int pos = next_free_slot(next, lo);
+        if (pos == n_carriers || capacity[carrier_order[pos]] == 0)
+            continue;
+
+        assignment[secret] = carrier_order[pos];
+        index->entries[carrier_order[pos]].assigned = 1;
+        next[pos] = pos + 1;
+    }
+
+    free(carrier_order); free(next); free(secret_order); free(need); free(capacity);
+    return e_success;
+}
+
+/* Free carrier index */
+void free_carrier_index(CarrierIndex *index)
+{
+    free(index->entries);
+    memset(index, 0, sizeof(*index));
+}
+
+/* Build or refresh carrier index
+ * Input: argc, argv (-i <index_file> <carrier_dir>)
+ * Output: Returns e_success or e_failure
+ * Description: Loads the existing index, refreshes it against the
+ * carrier directory and writes it back.
+ */
+Status do_indexing(int argc, char *argv[])
+{
+    if (argc != 4)
+    {
+        printf("\033[1;36m❌ ERROR: Usage: ./a.out -i <index_file> <carrier_dir>\033[0m\n");
+        return e_failure;
+    }
+
+    CarrierIndex index;
+    if (load_carrier_index(argv[2], &index) != e_success)
+        return e_failure;
+
+    Status ret = e_failure;
+    if (refresh_carrier_index(&index, argv[3]) == e_success)
+        ret = save_carrier_index(argv[2], &index);
+
+    free_carrier_index(&index);
+    return ret;
+}
+
+/* Plan carriers for a batch of secrets
+ * Input: argc, argv (-p <index_file> <secret_file>... [options])
+ * Output: Returns e_success if every secret got a carrier
+ * Description: Prints one "secret -> carrier" line per secret. The
+ * encode options (--ecc, --alpha, ...) change what each job needs.
+ */
+Status do_planning(int argc, char *argv[])
+{
+    StegoOptions opts = {0};
+    if (parse_stego_options(&argc, argv, &opts) != e_success)
+        return e_failure;
+    if (argc < 4)
+    {
+        printf("\033[1;36m❌ ERROR: Usage: ./a.out -p <index_file> <secret_file>... [options]\033[0m\n");
+        return e_failure;
+    }
+
+    CarrierIndex index;
+    if (load_carrier_index(argv[2], &index) != e_success)
+        return e_failure;
+
+    int n_secrets = argc - 3;
+    int *assignment = malloc(n_secrets * sizeof(int));
+    if (assignment == NULL || plan_carrier_assignment(&index, argv + 3, n_secrets, &opts, assignment) != e_success)
+    {
+        free(assignment);
+        free_carrier_index(&index);
+        return e_failure;
+    }
+
+    Status ret = e_success;
+    for (int i = 0; i < n_secrets; i++)
+    {
+        if (assignment[i] < 0)
+        {
+            printf("%s -> (no carrier fits)\n", argv[3 + i]);
+            ret = e_failure;
+        }
+        else
+            printf("%s -> %s\n", argv[3 + i], index.entries[assignment[i]].path);
+    }
+
+    free(assignment);
+    free_carrier_index(&index);
+    return ret;
+}
@@ -0,0 +1,65 @@
+#ifndef CARRIER_INDEX_H
+#define CARRIER_INDEX_H
+
+#include <stdio.h>
+#include "types.h" // Contains user defined types
+#include "options.h" // Encode options the plan is for
+
+/*
+ * Persistent index of a carrier library.
+ * Each entry is built from a header-only read of the
+ * carrier and is reused as long as size and mtime match.
+ */
+
+#define MAX_CARRIER_PATH 1024
+#define CARRIER_INDEX_MAGIC "# stego carrier index v2"
+#define CARRIER_INDEX_MAGIC_V1 "# stego carrier index v1"
+
+typedef struct _CarrierEntry
+{
+    char path[MAX_CARRIER_PATH];
+    uint width;
+    uint height;
+    uint bytes_per_pixel;
+    uint stride;
+    long long capacity;
+    long size;
+    long mtime;
+
+    /* Planner state */
+    int assigned;
+} CarrierEntry;
+
+typedef struct _CarrierIndex
+{
+    CarrierEntry *entries;
+    uint count;
+    uint alloc;
+} CarrierIndex;
+
+
+/* Carrier index function prototype */
+
+/* Build or refresh an index: -i <index_file> <carrier_dir> */
+Status do_indexing(int argc, char *argv[]);
+
+/* Plan carriers for secrets: -p <index_file> <secret_file>... [options] */
+Status do_planning(int argc, char *argv[]);
+
+/* Load index from disk, an absent file gives an empty index */
+Status load_carrier_index(const char *index_fname, CarrierIndex *index);
+
+/* Write index to disk through a temp file and rename */
+Status save_carrier_index(const char *index_fname, CarrierIndex *index);
+
+/* Rescan carrier directory, re-reading only new or changed headers */
+Status refresh_carrier_index(CarrierIndex *index, const char *carrier_dir);
+
+/* Best-fit assignment of secrets to carriers, -1 when nothing fits */
+Status plan_carrier_assignment(CarrierIndex *index, char *secret_fnames[], int n_secrets, const StegoOptions *opts,
+                               int *assignment);
+
+/* Release index memory */
+void free_carrier_index(CarrierIndex *index);
+
+#endif
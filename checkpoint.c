@@ -0,0 +1,306 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "checkpoint.h"
+#include "common.h"
+#include "types.h"
+
+/* Largest prime below 2^16 and the longest run without a modulo */
+#define ADLER_MOD 65521u
+#define ADLER_NMAX 5552
+
+/* Function Definitions */
+
+/* Adler-32
+ * Input: Running checksum (1 to start), bytes and their count
+ * Output: Updated checksum
+ * Description: The modulo is taken once per ADLER_NMAX bytes, the
+ * most that can be summed without overflowing 32 bits.
+ */
+uint adler32_update(uint adler, const unsigned char *buf, long len)
+{
+    uint a = adler & 0xffff, b = adler >> 16;
+
+    while (len > 0)
+    {
+        long n = len < ADLER_NMAX ? len : ADLER_NMAX;
+        len -= n;
+        while (n--)
+        {
+            a += *buf++;
+            b += a;
+        }
+        a %= ADLER_MOD;
+        b %= ADLER_MOD;
+    }
+    return (b << 16) | a;
+}
+
+/* FNV-1a, 64 bit */
+unsigned long long checkpoint_hash(unsigned long long hash, const void *data, long len)
+{
+    const unsigned char *p = data;
+    if (hash == 0)
+        hash = 0xcbf29ce484222325ull;
+    for (long i = 0; i < len; i++)
+    {
+        hash ^= p[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/* Hash the size and modification time of an open file */
+unsigned long long checkpoint_hash_file(unsigned long long hash, FILE *fptr)
+{
+    struct stat st;
+    long long fields[3] = {0};
+
+    if (fstat(fileno(fptr), &st) == 0)
+    {
+        fields[0] = st.st_size;
+        fields[1] = st.st_mtim.tv_sec;
+        fields[2] = st.st_mtim.tv_nsec;
+    }
+    return checkpoint_hash(hash, fields, sizeof(fields));
+}
+
+/* Checkpoint init
+ * Input: Checkpoint, name of the finished output
+ * Output: None
+ * Description: Derives "<name>.part" and "<name>.ckpt".
+ */
+void checkpoint_init(Checkpoint *ck, const char *final_fname)
+{
+    memset(ck, 0, sizeof(*ck));
+    ck->active = 1;
+    ck->adler = 1;
+    snprintf(ck->final_fname, sizeof(ck->final_fname), "%s", final_fname);
+    snprintf(ck->part_fname, sizeof(ck->part_fname), "%s.part", final_fname);
+    snprintf(ck->sidecar_fname, sizeof(ck->sidecar_fname), "%s.ckpt", final_fname);
+}
+
+/* Open output
+ * Input: Initialised checkpoint, resume flag
+ * Output: Stream on the .part file, NULL on error
+ * Description: A resumed job keeps the existing .part contents, its
+ * prefix is checked later by checkpoint_resume().
+ */
+FILE *checkpoint_open_output(Checkpoint *ck, int resume)
+{
+    FILE *fptr = NULL;
+    if (resume)
+        fptr = fopen(ck->part_fname, "r+b");
+    if (fptr == NULL)
+        fptr = fopen(ck->part_fname, "wb");
+    return fptr;
+}
+
+/* Order records by progress */
+static int compare_records(const void *a, const void *b)
+{
+    const CheckpointRecord *ra = a, *rb = b;
+    return (ra->payload_done > rb->payload_done) - (ra->payload_done < rb->payload_done);
+}
+
+/* Record self check: Adler-32 of every field before it */
+static uint record_check(const CheckpointRecord *rec)
+{
+    return adler32_update(1, (const unsigned char *)rec, offsetof(CheckpointRecord, check));
+}
+
+/* Checkpoint resume
+ * Input: Checkpoint, job id, output positioned at the payload,
+ *        resume flag, output bytes per payload unit
+ * Output: Returns e_success or e_failure on I/O error
+ * Description:
+ * Loads the sidecar records of this job, then reads the payload
+ * prefix of the output once, comparing the running Adler-32 at each
+ * record's offset. payload_done is set to the last record that
+ * matches (0 if none) and out is positioned right after it.
+ */
+Status checkpoint_resume(Checkpoint *ck, unsigned long long job_id, FILE *out, int resume, long unit)
+{
+    ck->job_id = job_id;
+    ck->payload_done = 0;
+    ck->adler = 1;
+    ck->since_saved = 0;
+    ck->records = 0;
+    if (!ck->active || !resume)
+        return e_success;
+
+    FILE *fptr_sidecar = fopen(ck->sidecar_fname, "rb");
+    if (fptr_sidecar == NULL)
+    {
+        printf("\033[1;36m⏮️  No checkpoint found — starting from the beginning.\033[0m\n");
+        return e_success;
+    }
+
+    // Valid records of this job; torn or foreign ones are skipped
+    CheckpointRecord rec, *recs = NULL;
+    int n = 0, cap = 0;
+    while (fread(&rec, sizeof(rec), 1, fptr_sidecar) == 1)
+    {
+        if (memcmp(rec.magic, CHECKPOINT_MAGIC, 4) != 0 || rec.check != record_check(&rec) ||
+            rec.job_id != job_id || rec.payload_done <= 0)
+            continue;
+        if (n == cap)
+        {
+            cap = cap ? cap * 2 : 16;
+            CheckpointRecord *grown = realloc(recs, cap * sizeof(*recs));
+            if (grown == NULL)
+                break;
+            recs = grown;
+        }
+        recs[n++] = rec;
+    }
+    fclose(fptr_sidecar);
+    qsort(recs, n, sizeof(*recs), compare_records);
+
+    // One pass over the prefix, checking every record on the way
+    // (the stream may have just been written, so flush before reading)
+    long start = fflush(out) == 0 ? ftell(out) : -1;
+    unsigned char *buffer = malloc(STEGO_CHUNK_SIZE);
+    uint adler = 1;
+    long long pos = 0;
+    int matched = -1, ok = buffer != NULL && start >= 0;
+
+    for (int i = 0; ok && i < n; i++)
+    {
+        long long end = recs[i].payload_done * unit;
+        while (ok && pos < end)
+        {
+            long want = end - pos < STEGO_CHUNK_SIZE ? end - pos : STEGO_CHUNK_SIZE;
+            ok = fread(buffer, 1, want, out) == (size_t)want;
+            adler = adler32_update(adler, buffer, want);
+            pos += want;
+        }
+        if (!ok || adler != recs[i].adler)
+            break;
+        matched = i;
+    }
+
+    if (matched >= 0)
+    {
+        ck->payload_done = recs[matched].payload_done;
+        ck->adler = recs[matched].adler;
+        ck->records = matched + 1;
+
+        // Keep only the records that still hold; new ones are appended
+        char tmp_fname[CHECKPOINT_NAME_MAX + 4];
+        snprintf(tmp_fname, sizeof(tmp_fname), "%s.tmp", ck->sidecar_fname);
+        FILE *fptr_tmp = fopen(tmp_fname, "wb");
+        if (fptr_tmp == NULL || fwrite(recs, sizeof(*recs), matched + 1, fptr_tmp) != (size_t)(matched + 1) ||
+            fflush(fptr_tmp) != 0 || fdatasync(fileno(fptr_tmp)) != 0 || fclose(fptr_tmp) != 0 ||
+            rename(tmp_fname, ck->sidecar_fname) != 0)
+            ok = 0;
+    }
+    free(buffer);
+    free(recs);
+    if (matched >= 0 && !ok)
+        return e_failure;
+
+    // Anything after the verified prefix is written again
+    long keep = start + ck->payload_done * unit;
+    if (start < 0 || fflush(out) != 0 || ftruncate(fileno(out), keep) != 0 || fseek(out, keep, SEEK_SET) != 0)
+        return e_failure;
+
+    if (matched >= 0)
+        printf("\033[1;36m⏩ Resuming after checkpoint: %lld payload bytes verified.\033[0m\n", ck->payload_done);
+    else
+        printf("\033[1;36m⏮️  No usable checkpoint — starting from the beginning.\033[0m\n");
+    return e_success;
+}
+
+/* Checkpoint progress
+ * Input: Checkpoint, output, bytes just written, payload units done
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Folds the bytes into the running Adler-32. Once per
+ * CHECKPOINT_INTERVAL bytes the output is synced first and then a
+ * record vouching for it is appended and synced, so a record never
+ * points past data that is not on disk.
+ */
+Status checkpoint_progress(Checkpoint *ck, FILE *out, const unsigned char *buf, long len, long long payload_done)
+{
+    if (!ck->active)
+        return e_success;
+
+    ck->adler = adler32_update(ck->adler, buf, len);
+    ck->since_saved += len;
+    if (ck->since_saved < CHECKPOINT_INTERVAL)
+        return e_success;
+    ck->since_saved = 0;
+
+    if (fflush(out) != 0 || fdatasync(fileno(out)) != 0)
+        return e_failure;
+
+    // A fresh job replaces any old sidecar, a resumed one extends it
+    if (ck->fptr_sidecar == NULL)
+        ck->fptr_sidecar = fopen(ck->sidecar_fname, ck->records ? "ab" : "wb");
+    if (ck->fptr_sidecar == NULL)
+    {
+        perror("fopen");
+        return e_failure;
+    }
+
+    CheckpointRecord rec = {0};
+    memcpy(rec.magic, CHECKPOINT_MAGIC, 4);
+    rec.adler = ck->adler;
+    rec.job_id = ck->job_id;
+    rec.payload_done = payload_done;
+    rec.check = record_check(&rec);
+    if (fwrite(&rec, sizeof(rec), 1, ck->fptr_sidecar) != 1 || fflush(ck->fptr_sidecar) != 0 ||
+        fdatasync(fileno(ck->fptr_sidecar)) != 0)
+        return e_failure;
+
+    ck->records++;
+    return e_success;
+}
+
+/* Checkpoint commit
+ * Input: Checkpoint, finished output
+ * Output: Returns e_success or e_failure
+ * Description: The complete output is synced and renamed over the
+ * final name in one step, then the sidecar is removed.
+ */
+Status checkpoint_commit(Checkpoint *ck, FILE *out)
+{
+    if (!ck->active)
+        return e_success;
+
+    if (fflush(out) != 0 || fsync(fileno(out)) != 0 || rename(ck->part_fname, ck->final_fname) != 0)
+    {
+        perror("rename");
+        return e_failure;
+    }
+
+    if (ck->fptr_sidecar)
+        fclose(ck->fptr_sidecar);
+    ck->fptr_sidecar = NULL;
+    unlink(ck->sidecar_fname);
+    ck->active = 0;
+    return e_success;
+}
+
+/* Checkpoint abort
+ * Input: Checkpoint of a failed job
+ * Output: None
+ * Description: A .part file with checkpoints is kept for --resume,
+ * one without any is of no use and is removed.
+ */
+void checkpoint_abort(Checkpoint *ck)
+{
+    if (!ck->active)
+        return;
+
+    if (ck->fptr_sidecar)
+        fclose(ck->fptr_sidecar);
+    ck->fptr_sidecar = NULL;
+    if (ck->records == 0)
+        unlink(ck->part_fname);
+    ck->active = 0;
+}
@@ -0,0 +1,84 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdio.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * Checkpointed output for long encode / decode jobs.
+ *
+ * The output is written to "<name>.part" and renamed to <name>
+ * only once it is complete and synced. Every CHECKPOINT_INTERVAL
+ * output bytes the output is synced and a record is appended to the
+ * sidecar "<name>.ckpt":
+ *
+ *   magic "SCKP" | Adler-32 of the payload output so far |
+ *   job id | payload bytes done | Adler-32 of the record
+ *
+ * The job id is a hash of the inputs (sizes, mtimes) and of the
+ * embedded header, so a record never resumes a different job.
+ * With --resume the payload prefix of the .part file is read back
+ * once; the last record whose checksum still matches is where the
+ * job continues. A torn or stale record is simply not used.
+ */
+
+#define CHECKPOINT_INTERVAL (256L * 1024 * 1024)
+#define CHECKPOINT_MAGIC "SCKP"
+#define CHECKPOINT_NAME_MAX 1100
+
+typedef struct _CheckpointRecord
+{
+    char magic[4];
+    uint adler;
+    unsigned long long job_id;
+    long long payload_done;
+    uint check;
+    uint reserved;
+} CheckpointRecord;
+
+typedef struct _Checkpoint
+{
+    int active;                 /* Only for outputs we named ourselves */
+    char final_fname[CHECKPOINT_NAME_MAX];
+    char part_fname[CHECKPOINT_NAME_MAX];
+    char sidecar_fname[CHECKPOINT_NAME_MAX];
+    FILE *fptr_sidecar;
+
+    unsigned long long job_id;
+    long long payload_done;     /* Payload units already in the output */
+    uint adler;                 /* Adler-32 of the payload output written */
+    long since_saved;           /* Output bytes since the last record */
+    int records;                /* Records written or reused */
+} Checkpoint;
+
+
+/* Checkpoint function prototype */
+
+/* Update an Adler-32 checksum (start with 1) */
+uint adler32_update(uint adler, const unsigned char *buf, long len);
+
+/* FNV-1a hash step used for job ids (start with 0) */
+unsigned long long checkpoint_hash(unsigned long long hash, const void *data, long len);
+
+/* Hash size and mtime of an open file into a job id */
+unsigned long long checkpoint_hash_file(unsigned long long hash, FILE *fptr);
+
+/* Name the output, the .part file and the sidecar, and activate */
+void checkpoint_init(Checkpoint *ck, const char *final_fname);
+
+/* Open the .part output: reused with resume, else truncated */
+FILE *checkpoint_open_output(Checkpoint *ck, int resume);
+
+/* Verify the written prefix against the sidecar and position out after it */
+Status checkpoint_resume(Checkpoint *ck, unsigned long long job_id, FILE *out, int resume, long unit);
+
+/* Account for len payload output bytes, save a record when due */
+Status checkpoint_progress(Checkpoint *ck, FILE *out, const unsigned char *buf, long len, long long payload_done);
+
+/* Sync the output, rename it into place and drop the sidecar */
+Status checkpoint_commit(Checkpoint *ck, FILE *out);
+
+/* Job failed: keep .part and sidecar for --resume if any record exists */
+void checkpoint_abort(Checkpoint *ck);
+
+#endif
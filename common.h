@@ -4,6 +4,9 @@
 /* Magic string to identify whether stegged or not */
 #define MAGIC_STRING "#*"
 
+/* Secret bytes handled per chunk by the data loops */
+#define STEGO_CHUNK_SIZE (64 * 1024)
+
 #endif
 
 
@@ -0,0 +1,605 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "daemon.h"
+#include "encode.h"
+#include "decode.h"
+#include "ecc.h"
+#include "types.h"
+
+/* Accepted connections waiting for a worker */
+typedef struct _JobQueue
+{
+    int conns[DAEMON_QUEUE_LEN];
+    int head;
+    int count;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} JobQueue;
+
+/* Per-worker state: the warm buffers reused for every job */
+typedef struct _Worker
+{
+    pthread_t thread;
+    JobQueue *queue;
+    char *buffers[DAEMON_MAX_FDS];
+} Worker;
+
+static volatile sig_atomic_t daemon_stop;
+
+/* Function Definitions */
+
+static void handle_stop_signal(int sig)
+{
+    (void)sig;
+    daemon_stop = 1;
+}
+
+/* Send daemon request
+ * Input: Connected socket, request, descriptors to pass
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Sends the fixed-size request as normal data and the
+ * descriptors as one SCM_RIGHTS control message.
+ */
+Status send_daemon_request(int sock, const DaemonRequest *req, const int *fds, int n_fds)
+{
+    char control[CMSG_SPACE(sizeof(int) * DAEMON_MAX_FDS)];
+    struct iovec iov = { (void *)req, sizeof(*req) };
+    struct msghdr msg = {0};
+
+    if (n_fds <= 0 || n_fds > DAEMON_MAX_FDS)
+        return e_failure;
+
+    memset(control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * n_fds);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * n_fds);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * n_fds);
+
+    if (sendmsg(sock, &msg, 0) != sizeof(*req))
+        return e_failure;
+    return e_success;
+}
+
+/* Receive daemon request
+ * Input: Connected socket, request and descriptor array to fill
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Receives the request and the attached descriptors. On failure
+ * any descriptors that did arrive are closed. The options come
+ * from the client and are checked as parse_stego_options would.
+ */
+Status recv_daemon_request(int sock, DaemonRequest *req, int *fds, int *n_fds)
+{
+    char control[CMSG_SPACE(sizeof(int) * DAEMON_MAX_FDS)];
+    struct iovec iov = { req, sizeof(*req) };
+    struct msghdr msg = {0};
+
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    *n_fds = 0;
+
+    ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (n >= 0 && cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+    {
+        *n_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * *n_fds);
+    }
+
+    const StegoOptions *opts = &req->opts;
+    if (n != sizeof(*req) || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) || *n_fds == 0 ||
+        (opts->flags & ~DAEMON_OPTS) || (unsigned)req->carrier_format > e_carrier_raw ||
+        ((opts->flags & OPT_ECC) && (opts->ecc_nsym < 2 || opts->ecc_nsym > ECC_MAX_NSYM)) ||
+        ((opts->flags & OPT_MATRIX) && opts->matrix_k != 2 && opts->matrix_k != 4))
+    {
+        for (int i = 0; i < *n_fds; i++)
+            close(fds[i]);
+        *n_fds = 0;
+        return e_failure;
+    }
+
+    // Extension comes from the client, never trust its termination
+    req->extn_secret_file[MAX_FILE_SUFFIX_ - 1] = '\0';
+    req->opts.cache_dir = NULL;
+    return e_success;
+}
+
+/* Wrap a received descriptor in a stdio stream using a warm buffer */
+static FILE *open_warm_stream(int fd, const char *mode, char *buffer)
+{
+    FILE *fptr = fdopen(fd, mode);
+    if (fptr == NULL)
+    {
+        close(fd);
+        return NULL;
+    }
+    setvbuf(fptr, buffer, _IOFBF, DAEMON_BUF_SIZE);
+    return fptr;
+}
+
+/* Run encode job
+ * Input: Request, descriptors, worker buffers, reply buffer
+ * Output: Returns e_success or e_failure
+ * Description: Same steps as a command line encode, on streams
+ * built from the client's descriptors instead of file names.
+ */
+static Status run_encode_job(DaemonRequest *req, int *fds, char **buffers, char *reply, int reply_len)
+{
+    EncodeInfo encInfo = {0};
+
+    encInfo.src_image_fname = "<src fd>";
+    encInfo.secret_fname = "<secret fd>";
+    encInfo.stego_image_fname = "<stego fd>";
+    encInfo.fptr_src_image = open_warm_stream(fds[0], "rb", buffers[0]);
+    encInfo.fptr_secret = open_warm_stream(fds[1], "rb", buffers[1]);
+    encInfo.fptr_stego_image = open_warm_stream(fds[2], "wb", buffers[2]);
+    encInfo.carrier.format = req->carrier_format;
+    encInfo.opts = req->opts;
+    snprintf(encInfo.extn_secret_file, sizeof(encInfo.extn_secret_file), "%s", req->extn_secret_file);
+
+    Status ret = e_failure;
+    if (encInfo.fptr_src_image && encInfo.fptr_secret && encInfo.fptr_stego_image && encInfo.extn_secret_file[0] == '.')
+        ret = do_encoding(&encInfo);
+
+    // Stego must be flushed before the client is told it is done
+    if (encInfo.fptr_src_image) fclose(encInfo.fptr_src_image);
+    if (encInfo.fptr_secret) fclose(encInfo.fptr_secret);
+    if (encInfo.fptr_stego_image && fclose(encInfo.fptr_stego_image) != 0)
+        ret = e_failure;
+
+    if (ret == e_success)
+        snprintf(reply, reply_len, "OK %ld\n", encInfo.size_secret_file);
+    else
+        snprintf(reply, reply_len, "ERR encode failed\n");
+    return ret;
+}
+
+/* Run decode job
+ * Input: Request, descriptors, worker buffers, reply buffer
+ * Output: Returns e_success or e_failure
+ * Description: Decodes into the client's output descriptor and
+ * replies with the recovered extension so the client can name it.
+ */
+static Status run_decode_job(DaemonRequest *req, int *fds, char **buffers, char *reply, int reply_len)
+{
+    DecodeInfo decInfo = {0};
+
+    decInfo.carrier.format = req->carrier_format;
+    decInfo.opts = req->opts;
+
+    strcpy(decInfo.stego_image_fname, "<stego fd>");
+    strcpy(decInfo.secret_fname, "<output fd>");
+    decInfo.fptr_stego_image = open_warm_stream(fds[0], "rb", buffers[0]);
+    decInfo.fptr_secret = open_warm_stream(fds[1], "wb", buffers[1]);
+
+    Status ret = e_failure;
+    if (decInfo.fptr_stego_image && decInfo.fptr_secret)
+        ret = do_decoding(&decInfo);
+
+    if (decInfo.fptr_stego_image) fclose(decInfo.fptr_stego_image);
+    if (decInfo.fptr_secret && fclose(decInfo.fptr_secret) != 0)
+        ret = e_failure;
+
+    if (ret == e_success)
+        snprintf(reply, reply_len, "OK %s %ld\n", decInfo.extn_secret_file, decInfo.size_secret_file);
+    else
+        snprintf(reply, reply_len, "ERR decode failed\n");
+    return ret;
+}
+
+/* Run scan job: report geometry and capacity of an image */
+static Status run_scan_job(int *fds, char **buffers, char *reply, int reply_len)
+{
+    FILE *fptr = open_warm_stream(fds[0], "rb", buffers[0]);
+    uint width, height, bpp;
+
+    Status ret = e_failure;
+    if (fptr != NULL && read_bmp_geometry(fptr, &width, &height, &bpp) == e_success)
+        ret = e_success;
+    if (fptr) fclose(fptr);
+
+    if (ret == e_success)
+        snprintf(reply, reply_len, "OK %u %u %u %llu\n", width, height, bpp, (unsigned long long)width * height * 3);
+    else
+        snprintf(reply, reply_len, "ERR scan failed\n");
+    return ret;
+}
+
+/* Serve one connection
+ * Input: Connected socket and the worker's buffers
+ * Description: Receives one request, runs it, writes the result line.
+ * A client that connects and sends nothing holds the worker for at
+ * most DAEMON_RECV_TIMEOUT seconds.
+ */
+static void serve_connection(int conn, char **buffers)
+{
+    DaemonRequest req;
+    int fds[DAEMON_MAX_FDS];
+    int n_fds;
+    char reply[128];
+    struct timeval timeout = { DAEMON_RECV_TIMEOUT, 0 };
+
+    if (setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+        recv_daemon_request(conn, &req, fds, &n_fds) != e_success)
+        snprintf(reply, sizeof(reply), "ERR bad request\n");
+    else if (req.op == DAEMON_OP_ENCODE && n_fds == 3)
+        run_encode_job(&req, fds, buffers, reply, sizeof(reply));
+    else if (req.op == DAEMON_OP_DECODE && n_fds == 2)
+        run_decode_job(&req, fds, buffers, reply, sizeof(reply));
+    else if (req.op == DAEMON_OP_SCAN && n_fds == 1)
+        run_scan_job(fds, buffers, reply, sizeof(reply));
+    else
+    {
+        for (int i = 0; i < n_fds; i++)
+            close(fds[i]);
+        snprintf(reply, sizeof(reply), "ERR unsupported op\n");
+    }
+
+    if (write(conn, reply, strlen(reply)) < 0)
+        perror("write");
+    close(conn);
+}
+
+/* Worker thread: take connections off the queue until stopped */
+static void *worker_main(void *arg)
+{
+    Worker *worker = arg;
+    JobQueue *queue = worker->queue;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&queue->lock);
+        while (queue->count == 0)
+            pthread_cond_wait(&queue->not_empty, &queue->lock);
+        int conn = queue->conns[queue->head];
+        queue->head = (queue->head + 1) % DAEMON_QUEUE_LEN;
+        queue->count--;
+        pthread_cond_signal(&queue->not_full);
+        pthread_mutex_unlock(&queue->lock);
+
+        // Negative entry is the shutdown marker
+        if (conn < 0)
+            break;
+        serve_connection(conn, worker->buffers);
+    }
+    return NULL;
+}
+
+/* Queue a connection (or shutdown marker), blocking when full */
+static void push_job(JobQueue *queue, int conn)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == DAEMON_QUEUE_LEN)
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+    queue->conns[(queue->head + queue->count) % DAEMON_QUEUE_LEN] = conn;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+/* Let queued jobs finish, then stop and join the first n workers */
+static void stop_workers(JobQueue *queue, Worker *workers, long n)
+{
+    for (long i = 0; i < n; i++)
+        push_job(queue, -1);
+    for (long i = 0; i < n; i++)
+        pthread_join(workers[i].thread, NULL);
+}
+
+/* Bind a listening Unix socket at path, replacing a stale one */
+static int listen_unix_socket(const char *path)
+{
+    struct sockaddr_un addr = {0};
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        printf("\033[1;36m❌ ERROR: Socket path too long\033[0m\n");
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    unlink(path);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(sock, DAEMON_QUEUE_LEN) != 0)
+    {
+        perror("bind");
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/* Run daemon
+ * Input: argc, argv (-s <socket_path> [workers])
+ * Output: Returns e_success when stopped by SIGINT/SIGTERM,
+ * e_failure if the workers cannot be started
+ * Description:
+ * Preallocates the aligned buffers for every worker, starts the
+ * worker threads, then accepts connections and hands them over
+ * through a bounded queue. No per-job process or buffer setup.
+ */
+Status do_daemon(int argc, char *argv[])
+{
+    if (argc != 3 && argc != 4)
+    {
+        printf("\033[1;36m❌ ERROR: Usage: ./a.out -s <socket_path> [workers]\033[0m\n");
+        return e_failure;
+    }
+
+    long n_workers = argc == 4 ? atol(argv[3]) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_workers < 1)
+        n_workers = 1;
+
+    int sock = listen_unix_socket(argv[2]);
+    if (sock < 0)
+        return e_failure;
+
+    // One aligned block holds every worker's buffers
+    char *pool = NULL;
+    Worker *workers = calloc(n_workers, sizeof(Worker));
+    if (workers == NULL || posix_memalign((void **)&pool, DAEMON_BUF_ALIGN, (size_t)n_workers * DAEMON_MAX_FDS * DAEMON_BUF_SIZE) != 0)
+    {
+        printf("\033[1;36m❌ ERROR: Unable to allocate worker buffers\033[0m\n");
+        free(workers);
+        close(sock);
+        return e_failure;
+    }
+
+    JobQueue queue = {0};
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.not_empty, NULL);
+    pthread_cond_init(&queue.not_full, NULL);
+
+    // No SA_RESTART, so accept() returns EINTR on shutdown
+    struct sigaction sa = {0};
+    sa.sa_handler = handle_stop_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Workers inherit a mask without the stop signals, so only the
+    // accept loop is interrupted and a job's I/O never sees EINTR
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+
+    Status ret = e_success;
+    long started;
+    for (started = 0; started < n_workers; started++)
+    {
+        workers[started].queue = &queue;
+        for (int b = 0; b < DAEMON_MAX_FDS; b++)
+            workers[started].buffers[b] = pool + (started * DAEMON_MAX_FDS + b) * DAEMON_BUF_SIZE;
+        int err = pthread_create(&workers[started].thread, NULL, worker_main, &workers[started]);
+        if (err != 0)
+        {
+            printf("\033[1;36m❌ ERROR: Unable to start worker %ld: %s\033[0m\n", started + 1, strerror(err));
+            ret = e_failure;
+            break;
+        }
+    }
+    pthread_sigmask(SIG_UNBLOCK, &stop_signals, NULL);
+
+    if (ret == e_success)
+    {
+        printf("\033[1;36m🛰️  Daemon listening on %s with %ld workers.\033[0m\n", argv[2], n_workers);
+        fflush(stdout);
+    }
+
+    while (ret == e_success && !daemon_stop)
+    {
+        int conn = accept4(sock, NULL, NULL, SOCK_CLOEXEC);
+        if (conn < 0)
+        {
+            if (errno != EINTR)
+                perror("accept");
+            continue;
+        }
+        push_job(&queue, conn);
+    }
+
+    stop_workers(&queue, workers, started);
+
+    close(sock);
+    unlink(argv[2]);
+    free(pool);
+    free(workers);
+    printf("\033[1;36m🛑 Daemon stopped.\033[0m\n");
+    return ret;
+}
+
+/* Connect to the daemon socket */
+static int connect_unix_socket(const char *path)
+{
+    struct sockaddr_un addr = {0};
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return -1;
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0)
+        return -1;
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/* Send request and read the reply line into reply */
+static Status daemon_round_trip(const char *path, DaemonRequest *req, int *fds, int n_fds, char *reply, int reply_len)
+{
+    int sock = connect_unix_socket(path);
+    if (sock < 0)
+    {
+        perror("connect");
+        return e_failure;
+    }
+
+    Status ret = send_daemon_request(sock, req, fds, n_fds);
+    int len = 0;
+    ssize_t n;
+    while (ret == e_success && len < reply_len - 1 && (n = read(sock, reply + len, reply_len - 1 - len)) > 0)
+        len += n;
+    reply[len] = '\0';
+    close(sock);
+
+    if (ret != e_success || strncmp(reply, "OK", 2) != 0)
+    {
+        printf("\033[1;36m❌ ERROR: Daemon replied: %s\033[0m\n", len ? reply : "(nothing)");
+        return e_failure;
+    }
+    return e_success;
+}
+
+/* Refuse options a daemon job cannot honour */
+static Status check_daemon_options(const StegoOptions *opts)
+{
+    if (opts->flags & ~DAEMON_OPTS)
+    {
+        printf("\033[1;36m❌ ERROR: --resume, --cache, --metrics, --explain and --direct are not available through the daemon\033[0m\n");
+        return e_failure;
+    }
+    return e_success;
+}
+
+/* Daemon client
+ * Input: argc, argv (-c <socket_path> <op> <args>)
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Validates arguments with the normal encode/decode validators,
+ * opens the files locally and passes only the descriptors. The
+ * carrier format and the "--" options travel with the request;
+ * options outside DAEMON_OPTS are refused here.
+ */
+Status do_daemon_client(int argc, char *argv[])
+{
+    if (argc < 5)
+    {
+        printf("\033[1;36m❌ ERROR: Usage: ./a.out -c <socket_path> -e|-d|-q <args>\033[0m\n");
+        return e_failure;
+    }
+
+    const char *path = argv[2];
+    DaemonRequest req = {0};
+    char reply[256];
+    Status ret = e_failure;
+
+    // Shift so the validators see "<x> -e <src> ..." as usual
+    argc -= 2;
+    argv += 2;
+
+    if (strcmp(argv[1], "-e") == 0)
+    {
+        EncodeInfo encInfo = {0};
+        if (read_and_validate_encode_args(argc, argv, &encInfo) != e_success ||
+            check_daemon_options(&encInfo.opts) != e_success || open_files(&encInfo) != e_success)
+            return e_failure;
+
+        int fds[3] = { fileno(encInfo.fptr_src_image), fileno(encInfo.fptr_secret), fileno(encInfo.fptr_stego_image) };
+        req.op = DAEMON_OP_ENCODE;
+        strcpy(req.extn_secret_file, encInfo.extn_secret_file);
+        req.carrier_format = encInfo.carrier.format;
+        req.opts = encInfo.opts;
+        ret = daemon_round_trip(path, &req, fds, 3, reply, sizeof(reply));
+
+        // The stego was opened as "<name>.part", move it into place
+        if (ret == e_success && checkpoint_commit(&encInfo.ckpt, encInfo.fptr_stego_image) != e_success)
+            ret = e_failure;
+        if (ret != e_success)
+            checkpoint_abort(&encInfo.ckpt);
+
+        fclose(encInfo.fptr_src_image);
+        fclose(encInfo.fptr_secret);
+        fclose(encInfo.fptr_stego_image);
+    }
+    else if (strcmp(argv[1], "-d") == 0)
+    {
+        DecodeInfo decInfo = {0};
+        if (read_and_validate_decode_args(argc, argv, &decInfo) != e_success ||
+            check_daemon_options(&decInfo.opts) != e_success)
+            return e_failure;
+
+        decInfo.fptr_stego_image = fopen(decInfo.stego_image_fname, "rb");
+        decInfo.fptr_secret = fopen(decInfo.secret_fname, "wb");
+        if (decInfo.fptr_stego_image && decInfo.fptr_secret)
+        {
+            int fds[2] = { fileno(decInfo.fptr_stego_image), fileno(decInfo.fptr_secret) };
+            req.op = DAEMON_OP_DECODE;
+            req.carrier_format = decInfo.carrier.format;
+            req.opts = decInfo.opts;
+            ret = daemon_round_trip(path, &req, fds, 2, reply, sizeof(reply));
+        }
+        else
+            perror("fopen");
+
+        if (decInfo.fptr_stego_image) fclose(decInfo.fptr_stego_image);
+        if (decInfo.fptr_secret) fclose(decInfo.fptr_secret);
+
+        // Output was created before the extension was known
+        char extn[MAX_FILE_SUFFIX_] = "";
+        if (ret == e_success && sscanf(reply, "OK %49s", extn) == 1)
+        {
+            char final_fname[sizeof(decInfo.secret_fname) + MAX_FILE_SUFFIX_];
+            snprintf(final_fname, sizeof(final_fname), "%s%s", decInfo.secret_fname, extn);
+            if (rename(decInfo.secret_fname, final_fname) != 0)
+                perror("rename");
+            printf("\033[1;36m🏆 SUCCESS: Decoded by daemon, saved as '%s'\033[0m\n", final_fname);
+        }
+        else if (ret != e_success)
+            remove(decInfo.secret_fname);
+        return ret;
+    }
+    else if (strcmp(argv[1], "-q") == 0)
+    {
+        FILE *fptr = fopen(argv[2], "rb");
+        if (fptr == NULL)
+        {
+            perror("fopen");
+            return e_failure;
+        }
+        int fds[1] = { fileno(fptr) };
+        req.op = DAEMON_OP_SCAN;
+        ret = daemon_round_trip(path, &req, fds, 1, reply, sizeof(reply));
+        fclose(fptr);
+    }
+    else
+    {
+        printf("\033[1;36m❌ ERROR: Unsupported daemon op %s\033[0m\n", argv[1]);
+        return e_failure;
+    }
+
+    if (ret == e_success)
+        printf("%s", reply);
+    return ret;
+}
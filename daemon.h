@@ -0,0 +1,64 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "types.h"  // Contains user defined types
+#include "decode.h" // For MAX_FILE_SUFFIX_, options and carrier formats
+
+/*
+ * Long-lived daemon mode.
+ * Clients connect over a Unix domain socket and send one
+ * request per connection together with the open file
+ * descriptors of the job (SCM_RIGHTS). A fixed set of worker
+ * threads, each owning preallocated aligned stdio buffers,
+ * runs the job and streams a one-line result back.
+ */
+
+#define DAEMON_QUEUE_LEN 64
+#define DAEMON_BUF_SIZE (64 * 1024)
+#define DAEMON_BUF_ALIGN 4096
+#define DAEMON_MAX_FDS 3
+#define DAEMON_RECV_TIMEOUT 5   /* Seconds a client has to send its request */
+
+/*
+ * Options a job may carry. The rest need file names or a terminal,
+ * and --direct would reopen the client's descriptors through /proc
+ * with the daemon's own rights instead of those passed.
+ */
+#define DAEMON_OPTS (OPT_PIPELINE | OPT_LEGACY_HEADER | OPT_ECC | OPT_RAW | OPT_ALPHA | \
+                     OPT_MATRIX | OPT_DEDUP)
+
+/* Request ops */
+#define DAEMON_OP_ENCODE 'e'    /* fds: src image, secret, stego image */
+#define DAEMON_OP_DECODE 'd'    /* fds: stego image, output file */
+#define DAEMON_OP_SCAN   'q'    /* fds: image */
+
+typedef struct _DaemonRequest
+{
+    char op;
+    char extn_secret_file[MAX_FILE_SUFFIX_];
+
+    /* Client's carrier format and "--" options (cache_dir is not sent) */
+    CarrierFormat carrier_format;
+    StegoOptions opts;
+} DaemonRequest;
+
+
+/* Daemon function prototype */
+
+/* Run the daemon: -s <socket_path> [workers] */
+Status do_daemon(int argc, char *argv[]);
+
+/* Send one job to a daemon:
+ * -c <socket_path> -e <src.bmp> <secret_file> [stego.bmp]
+ * -c <socket_path> -d <stego.bmp> [output_file]
+ * -c <socket_path> -q <image.bmp>
+ */
+Status do_daemon_client(int argc, char *argv[]);
+
+/* Send request with descriptors attached */
+Status send_daemon_request(int sock, const DaemonRequest *req, const int *fds, int n_fds);
+
+/* Receive request and its descriptors */
+Status recv_daemon_request(int sock, DaemonRequest *req, int *fds, int *n_fds);
+
+#endif
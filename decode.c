@@ -1,8 +1,22 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include "decode.h"
 #include "types.h"
 #include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "common.h"
+#include "stego_header.h"
+#include "ecc.h"
+#include "matrix.h"
+#include "dedup.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /* Function Definitions */
 
@@ -10,11 +24,15 @@
  * Input: argc, argv, DecodeInfo structure
  * Output: Fills DecodeInfo with valid file names
  * Description:
- * Validates the stego image file, checks its extension (.bmp),
+ * Validates the stego image file, checks its extension (carrier format),
  * and sets the output secret file name (default or user-provided).
  */
 Status read_and_validate_decode_args(int argc,char *argv[] , DecodeInfo *decInfo)
 {
+    // Strip "--" options first, positional layout stays the same
+    if (parse_stego_options(&argc, argv, &decInfo->opts) != e_success)
+        return e_failure;
+
     // Validate argument count
     if (argc != 3 && argc != 4)  
     {
@@ -22,11 +40,10 @@ Status read_and_validate_decode_args(int argc,char *argv[] , DecodeInfo *decInfo
         return e_failure;
     }
 
-    // Validate stego image file (must end with .bmp)
-    int len = strlen(argv[2]);
-    if (len < 3 || strcmp(argv[2] + len - 4,".bmp") != 0) 
+    // Validate stego image file (.bmp, .ppm, .pam, .raw or --raw)
+    if (carrier_format_from_name(argv[2], &decInfo->opts, &decInfo->carrier.format) != e_success)
     {
-        printf("\033[1;36m❌ ERROR: Stego image must be .bmp\033[0m\n");
+        printf("\033[1;36m❌ ERROR: Stego image must be .bmp, .ppm, .pam or .raw\033[0m\n");
         return e_failure;
     }
 
@@ -49,69 +66,226 @@ Status read_and_validate_decode_args(int argc,char *argv[] , DecodeInfo *decInfo
     return e_success ;
 }
 
-/* Perform decoding process
- * Input: DecodeInfo structure
- * Output: Returns e_success on success, else e_failure
+/* Start checkpointing
+ * Input: DecodeInfo, output opened, stego positioned at the payload
+ * Output: Returns e_success or e_failure
+ * Description: The job id covers the stego image and its header.
+ * With --resume the verified output prefix is skipped in the
+ * stego image too. ECC payloads are corrected as a whole, so they
+ * have no checkpoints and always start over.
+ */
+static Status start_decode_checkpoint(DecodeInfo *decInfo)
+{
+    long span = stego_payload_span(decInfo->header_flags);
+    long long fields[4] = { decInfo->header_flags, decInfo->ecc_nsym, decInfo->size_secret_file, decInfo->carrier.pixel_offset };
+
+    unsigned long long id = checkpoint_hash(0, "d", 1);
+    id = checkpoint_hash_file(id, decInfo->fptr_stego_image);
+    id = checkpoint_hash(id, fields, sizeof(fields));
+    id = checkpoint_hash(id, decInfo->extn_secret_file, strlen(decInfo->extn_secret_file));
+
+    if (checkpoint_resume(&decInfo->ckpt, id, decInfo->fptr_secret, decInfo->opts.flags & OPT_RESUME, 1) != e_success)
+        return e_failure;
+    if (fseek(decInfo->fptr_stego_image, decInfo->ckpt.payload_done * span, SEEK_CUR) != 0)
+        return e_failure;
+    return e_success;
+}
+
+/* Preallocate output
+ * Input: DecodeInfo with the output open
+ * Output: Returns e_success, e_failure when the disk is too small
+ * Description: The whole output is reserved in one go, so it is laid
+ * out in large extents and a full disk fails before any pixel is
+ * read. The file size is kept: a failed job leaves no zero tail
+ * behind its data. Filesystems and streams without fallocate are
+ * written as before.
+ */
+static Status preallocate_output(DecodeInfo *decInfo)
+{
+    if (fallocate(fileno(decInfo->fptr_secret), FALLOC_FL_KEEP_SIZE, 0, decInfo->size_secret_file) != 0 &&
+        (errno == ENOSPC || errno == EFBIG))
+    {
+        printf("\033[1;36m❌ ERROR: No room for the %ld-byte output\033[0m\n", decInfo->size_secret_file);
+        return e_failure;
+    }
+    return e_success;
+}
+
+/* Payload bytes as embedded (after dedup and ECC parity) */
+static long long stored_payload_size(const DecodeInfo *decInfo)
+{
+    long long stored = decInfo->size_secret_file;
+
+    if (decInfo->header_flags & STEGO_FLAG_DEDUP)
+        stored = decInfo->dedup_size;
+    if (decInfo->header_flags & STEGO_FLAG_ECC)
+        stored = ecc_encoded_size(stored, decInfo->ecc_nsym);
+    return stored;
+}
+
+/* Preflight
+ * Input: DecodeInfo, stego positioned at the payload
+ * Output: Returns e_success or e_failure
  * Description:
- * Skips the BMP header, validates the magic string,
- * and sequentially decodes the secret file details and data.
+ * Checks what the embedded header claims against the stego image
+ * before any output is created: the payload must fit in the pixel
+ * region by the encoder's capacity rule and in the file as it is,
+ * a dedup container cannot expand beyond its largest chunks, and
+ * the output name must have room for the extension. A corrupt or
+ * hostile image then fails here, without reading its pixels or
+ * leaving a partial file.
  */
-Status do_decoding(DecodeInfo *decInfo)
+static Status preflight_decode(DecodeInfo *decInfo)
 {
-    printf("\033[1;36m📂 Opening stego image: %s\033[0m\n", decInfo->stego_image_fname);
+    const CarrierInfo *carrier = &decInfo->carrier;
+    long long span = stego_payload_span(decInfo->header_flags);
+    long long region = carrier->capacity;
+    long long start = ftell(decInfo->fptr_stego_image);
+    struct stat st;
 
-    if (skip_bmp_header(decInfo) != e_success)
+    if (decInfo->header_flags & STEGO_FLAG_ALPHA)
+        region = (long long)carrier->width * carrier->height * STEGO_ALPHA_SPAN;
+
+    if (decInfo->size_secret_file <= 0)
     {
-        printf("\033[1;36m❌ ERROR: Failed to skip BMP header\033[0m\n");
+        printf("\033[1;36m❌ ERROR: Header claims an empty secret\033[0m\n");
         return e_failure;
     }
+    if ((decInfo->header_flags & STEGO_FLAG_DEDUP) &&
+        decInfo->size_secret_file / DEDUP_MAX_CHUNK > decInfo->dedup_size)
+    {
+        printf("\033[1;36m❌ ERROR: Header claims a %ld-byte secret from a %ld-byte dedup container\033[0m\n",
+               decInfo->size_secret_file, decInfo->dedup_size);
+        return e_failure;
+    }
+
+    if (start < 0 || fstat(fileno(decInfo->fptr_stego_image), &st) != 0)
+        return e_failure;
 
-    if (decode_magic_string(MAGIC_STRING, decInfo) != e_success)
+    // Compare before adding parity, so a huge claim cannot overflow
+    long long room = (region - (start - carrier->pixel_offset)) / span;
+    long long stored = (decInfo->header_flags & STEGO_FLAG_DEDUP) ? decInfo->dedup_size : decInfo->size_secret_file;
+    if (stored <= room)
+        stored = stored_payload_size(decInfo);
+    if (stored > room)
     {
-        printf("\033[1;36m❌ ERROR: Magic string mismatch\033[0m\n");
+        printf("\033[1;36m❌ ERROR: Header claims %lld payload bytes, the pixel region holds %lld\033[0m\n", stored, room);
         return e_failure;
     }
-    printf("\033[1;36m🔑 Magic string verified\033[0m\n");
 
-    if (decode_secret_file_extn_size(decInfo) != e_success)
+    long long end = start + stored * span;
+    if (S_ISREG(st.st_mode) && end > st.st_size)
     {
-        printf("\033[1;36m❌ ERROR: Failed to decode extension file size\033[0m\n");
+        printf("\033[1;36m❌ ERROR: Stego image truncated: payload ends at byte %lld, file has %lld\033[0m\n",
+               end, (long long)st.st_size);
         return e_failure;
     }
 
-    if (decode_secret_file_extn(decInfo) != e_success)
+    if (strlen(decInfo->secret_fname) + strlen(decInfo->extn_secret_file) >= sizeof(decInfo->secret_fname))
     {
-        printf("\033[1;36m❌ ERROR: Failed to decode extension\033[0m\n");
+        printf("\033[1;36m❌ ERROR: Output name too long\033[0m\n");
         return e_failure;
     }
 
-    if (decode_secret_file_size(decInfo) != e_success)
+    printf("\033[1;36m🛫 Preflight passed: payload takes %lld of %lld pixel bytes.\033[0m\n",
+           end - start, room * span);
+    return e_success;
+}
+
+/* Plan the I/O once the embedded header is known */
+static void plan_decode_io(DecodeInfo *decInfo)
+{
+    IoPlan *plan = &decInfo->io_plan;
+    struct stat st;
+
+    plan->decode = 1;
+    plan->carrier_size = fstat(fileno(decInfo->fptr_stego_image), &st) == 0 ? st.st_size : 0;
+    plan->touched = stored_payload_size(decInfo) * stego_payload_span(decInfo->header_flags);
+    plan->ecc = (decInfo->header_flags & (STEGO_FLAG_ECC | STEGO_FLAG_DEDUP)) != 0;
+    io_plan_probe(plan, fileno(decInfo->fptr_stego_image), -1);
+    io_plan_choose(plan, decInfo->opts.flags);
+
+    // Filesystems without O_DIRECT keep to buffered I/O
+    if (plan->strategy == e_io_direct && direct_open(&decInfo->direct, decInfo->fptr_stego_image, NULL) != e_success)
     {
-        printf("\033[1;36m❌ ERROR: Failed to decode secret file size\033[0m\n");
+        plan->strategy = e_io_stdio;
+        plan->reason = "--direct refused by the filesystem, buffered I/O instead";
+    }
+
+    // The flag follows the plan, so --direct or a refused --direct
+    // never leaves a --pipeline request to take another path
+    if (plan->strategy == e_io_pipeline)
+        decInfo->opts.flags |= OPT_PIPELINE;
+    else
+        decInfo->opts.flags &= ~OPT_PIPELINE;
+    if (decInfo->opts.flags & OPT_EXPLAIN)
+        io_plan_explain(plan);
+}
+
+/* Perform decoding process
+ * Input: DecodeInfo structure
+ * Output: Returns e_success on success, else e_failure
+ * Description:
+ * Skips the carrier header, reads and validates the embedded header
+ * (magic string, secret file details) and decodes the data.
+ */
+Status do_decoding(DecodeInfo *decInfo)
+{
+    printf("\033[1;36m📂 Opening stego image: %s\033[0m\n", decInfo->stego_image_fname);
+
+    if (skip_carrier_header(decInfo) != e_success)
+    {
+        printf("\033[1;36m❌ ERROR: Failed to skip carrier header\033[0m\n");
         return e_failure;
     }
 
-    if (decode_secret_file_data(decInfo) != e_success)
+    if (decode_stego_header(decInfo) != e_success)
     {
-        printf("\033[1;36m❌ ERROR: Failed to decode secret data\033[0m\n");
+        printf("\033[1;36m❌ ERROR: Failed to decode header\033[0m\n");
         return e_failure;
     }
 
+    // Reject impossible sizes before any output exists
+    if (preflight_decode(decInfo) != e_success)
+        return e_failure;
+
+    // Pick stdio, pipeline or mmap for this job
+    plan_decode_io(decInfo);
+
+    // Data goes to "<output>.part", renamed into place when complete
+    Status ret = e_success;
+    if (open_secret_file(decInfo) != e_success)
+        ret = e_failure;
+    else if (start_decode_checkpoint(decInfo) != e_success || preallocate_output(decInfo) != e_success ||
+             decode_secret_file_data(decInfo) != e_success ||
+             checkpoint_commit(&decInfo->ckpt, decInfo->fptr_secret) != e_success)
+    {
+        checkpoint_abort(&decInfo->ckpt);
+        printf("\033[1;36m❌ ERROR: Failed to decode secret data\033[0m\n");
+        ret = e_failure;
+    }
+    direct_close(&decInfo->direct);
+    if (ret != e_success)
+        return e_failure;
+
     printf("\033[1;36m🏆 SUCCESS: Decoding completed! Saved as '%s'\033[0m\n", decInfo->secret_fname);
     return e_success;
 }
 
-/* Skip BMP header
- * Input: DecodeInfo structure
+/* Skip carrier header
+ * Input: DecodeInfo structure (carrier format set)
  * Output: Returns e_success or e_failure
  * Description:
- * Opens the stego image and moves the file pointer past
- * the 64-byte BMP header to the pixel data region.
+ * Opens the stego image, parses its format header (54-byte BMP
+ * header, PPM/PAM header, nothing for raw buffers) and moves the
+ * file pointer to the pixel data region.
  */
-Status skip_bmp_header(DecodeInfo *decInfo)
+Status skip_carrier_header(DecodeInfo *decInfo)
 {
-    // Open the stego BMP image in binary read mode ("rb")
-    decInfo->fptr_stego_image = fopen(decInfo->stego_image_fname, "rb");
+    // Open the stego image in binary read mode ("rb"),
+    // unless the caller already handed us an open stream
+    if (decInfo->fptr_stego_image == NULL)
+        decInfo->fptr_stego_image = fopen(decInfo->stego_image_fname, "rb");
 
     // Check if the file was successfully opened
     if (!decInfo->fptr_stego_image)
@@ -121,14 +295,75 @@ Status skip_bmp_header(DecodeInfo *decInfo)
         return e_failure;
     }
 
-    // Move the file pointer 54 bytes from the start (SKIP BMP HEADER)
-    if (fseek(decInfo->fptr_stego_image, 54L, SEEK_SET) != 0)
+    if (probe_carrier(decInfo->fptr_stego_image, &decInfo->opts, &decInfo->carrier) != e_success)
+        return e_failure;
+    printf("\033[1;36m🖥️  Image dimensions: %u x %u pixels.\033[0m\n", decInfo->carrier.width, decInfo->carrier.height);
+
+    // Move the file pointer to the first pixel byte
+    if (fseek(decInfo->fptr_stego_image, decInfo->carrier.pixel_offset, SEEK_SET) != 0)
+    {
+        printf("\033[1;36m❌ ERROR: Failed to seek past carrier header\033[0m\n");
+        return e_failure;
+    }
+
+    printf("\033[1;36m📄 Skipped %ld-byte %s header\033[0m\n", decInfo->carrier.pixel_offset, carrier_format_extn(decInfo->carrier.format));
+    return e_success;
+}
+
+/* Decode stego header
+ * Input: DecodeInfo structure, stego image opened
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Fetches one bounded block of pixel bytes, parses and validates
+ * the compact (v2) or legacy (v1) header from it, and leaves the
+ * stego image positioned at the secret data.
+ */
+Status decode_stego_header(DecodeInfo *decInfo)
+{
+    StegoHeader hdr;
+
+    if (read_stego_header(decInfo->fptr_stego_image, decInfo->carrier.pixel_offset, &hdr) != e_success)
+        return e_failure;
+
+    decInfo->header_version = hdr.version;
+    decInfo->header_flags = hdr.flags;
+    decInfo->ecc_nsym = hdr.ecc_nsym;
+    decInfo->dedup_size = hdr.dedup_size;
+    decInfo->size_secret_file_extn = hdr.size_secret_file_extn;
+    strcpy(decInfo->extn_secret_file, hdr.extn_secret_file);
+    decInfo->size_secret_file = hdr.size_secret_file;
+
+    printf("\033[1;36m🔑 Magic string verified (header v%u)\033[0m\n", hdr.version);
+    printf("\033[1;36m📝 Decoded extension = '%s'\033[0m\n", decInfo->extn_secret_file);
+    printf("\033[1;36m📦 Secret file size = %ld bytes\033[0m\n", decInfo->size_secret_file);
+    return e_success;
+}
+
+/* Open secret file
+ * Input: DecodeInfo structure with decoded extension
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Appends the extension to the output file name and creates the
+ * output file (as "<name>.part"), unless the caller already handed
+ * us a stream.
+ */
+Status open_secret_file(DecodeInfo *decInfo)
+{
+    /* Append extension to output file name safely */
+    strcat(decInfo->secret_fname, decInfo->extn_secret_file);
+    printf("\033[1;36m📁 Output file = '%s'\033[0m\n", decInfo->secret_fname);
+
+    if (decInfo->fptr_secret == NULL)
+    {
+        checkpoint_init(&decInfo->ckpt, decInfo->secret_fname);
+        decInfo->fptr_secret = checkpoint_open_output(&decInfo->ckpt, decInfo->opts.flags & OPT_RESUME);
+    }
+    if (!decInfo->fptr_secret)
     {
-        printf("\033[1;36m❌ ERROR: Failed to seek past BMP header\033[0m\n");
+        perror("\033[1;36m❌ ERROR: fopen output file\033[0m");
         return e_failure;
     }
 
-    printf("\033[1;36m📄 Skipped 64-byte BMP header\033[0m\n");
     return e_success;
 }
 
@@ -211,18 +446,7 @@ Status decode_secret_file_extn(DecodeInfo *decInfo)
     /* Null-terminate extension */
     decInfo->extn_secret_file[decInfo->size_secret_file_extn] = '\0';
 
-    /* Append extension to output file name safely */
-    strcat(decInfo->secret_fname, decInfo->extn_secret_file);
-    printf("\033[1;36m📁 Output file = '%s'\033[0m\n", decInfo->secret_fname);
-
-    decInfo->fptr_secret = fopen(decInfo->secret_fname, "wb");
-    if (!decInfo->fptr_secret)
-    {
-        perror("\033[1;36m❌ ERROR: fopen output file\033[0m");
-        return e_failure;
-    }
-
-    return e_success;
+    return open_secret_file(decInfo);
 }
 
 /* Decode secret file size
@@ -256,38 +480,315 @@ Status decode_secret_file_size(DecodeInfo *decInfo)
  * Input: DecodeInfo structure
  * Output: Returns e_success or e_failure
  * Description:
- * Reads and decodes the secret data from the image
- * and writes it to the reconstructed output file.
+ * Reads the stego image a chunk at a time, decodes the secret
+ * bytes from the LSBs and writes them to the reconstructed output
+ * file. With --pipeline the stages overlap instead.
  */
 Status decode_secret_file_data(DecodeInfo *decInfo)
 {
     if (decInfo->size_secret_file <= 0)
         return e_failure;
+
+    if (decInfo->header_flags & STEGO_FLAG_DEDUP)
+        return decode_secret_file_data_dedup(decInfo);
+
+    if (decInfo->header_flags & STEGO_FLAG_ECC)
+        return decode_secret_file_data_ecc(decInfo);
+
+    if (decInfo->io_plan.strategy == e_io_direct)
+        return decode_payload_direct(NULL, decInfo->size_secret_file, decInfo);
+
+    if (decInfo->io_plan.strategy == e_io_pipeline)
+        return decode_secret_file_data_pipelined(decInfo);
+
+    if (decInfo->io_plan.strategy == e_io_mmap)
+        return decode_secret_file_data_mapped(decInfo);
         
-    /* Buffer to hold 8 bytes of image data */
-    unsigned char buffer[8];
+    /* Image bytes for one chunk and the secret bytes they hold */
+    long span = stego_payload_span(decInfo->header_flags);
+    unsigned char *buffer = malloc(STEGO_CHUNK_SIZE * span);
+    unsigned char *data = malloc(STEGO_CHUNK_SIZE);
+    Status ret = (data && buffer) ? e_success : e_failure;
 
-    /* To hold one decoded character */
-    char ch;
+    for (long done = decInfo->ckpt.payload_done; ret == e_success && done < decInfo->size_secret_file; )
+    {
+        long n = decInfo->size_secret_file - done;
+        if (n > STEGO_CHUNK_SIZE)
+            n = STEGO_CHUNK_SIZE;
+
+        // Read span bytes from stego image per secret byte, decode
+        // the chunk from LSBs (or alpha) and write it to secret file
+        if (fread(buffer, 1, n * span, decInfo->fptr_stego_image) != (size_t)(n * span) ||
+            decode_payload_chunk(decInfo, data, n, buffer) != e_success ||
+            fwrite(data, 1, n, decInfo->fptr_secret) != (size_t)n ||
+            checkpoint_progress(&decInfo->ckpt, decInfo->fptr_secret, data, n, done + n) != e_success)
+            ret = e_failure;
+        done += n;
+    }
+
+    free(buffer);
+    free(data);
+    return ret;
+}
+
+/* Decode secret file data from a mapping
+ * Input: DecodeInfo structure, stego positioned at the payload
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Maps the stego image read-only and extracts the payload chunk by
+ * chunk straight from the mapping, so no image bytes are copied
+ * into a read buffer. Leaves the stream after the payload.
+ */
+Status decode_secret_file_data_mapped(DecodeInfo *decInfo)
+{
+    long span = stego_payload_span(decInfo->header_flags);
+    long start = decInfo->ckpt.payload_done;
+    long pos = ftell(decInfo->fptr_stego_image);
+    long long end = pos + (long long)(decInfo->size_secret_file - start) * span;
+    struct stat st;
+
+    if (pos < 0 || fstat(fileno(decInfo->fptr_stego_image), &st) != 0 || end > st.st_size)
+        return e_failure;
 
-    for (long i = 0; i < decInfo->size_secret_file; i++)
+    unsigned char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(decInfo->fptr_stego_image), 0);
+    unsigned char *data = malloc(STEGO_CHUNK_SIZE);
+    if (map == MAP_FAILED || data == NULL)
     {
-        // Read 8 bytes from stego image
-        if (fread(buffer, 1, 8, decInfo->fptr_stego_image) != 8)
-            return e_failure;
+        if (map != MAP_FAILED)
+            munmap(map, st.st_size);
+        free(data);
+        return e_failure;
+    }
+    madvise(map + (pos & ~(sysconf(_SC_PAGESIZE) - 1)), end - (pos & ~(sysconf(_SC_PAGESIZE) - 1)), MADV_SEQUENTIAL);
 
-        // Decode one byte from LSBs
-        if (decode_byte_from_lsb(&ch, (char *)buffer) != e_success)
-            return e_failure;
+    const unsigned char *image = map + pos;
+    Status ret = e_success;
+    for (long done = start; ret == e_success && done < decInfo->size_secret_file; )
+    {
+        long n = decInfo->size_secret_file - done;
+        if (n > STEGO_CHUNK_SIZE)
+            n = STEGO_CHUNK_SIZE;
+
+        // Decode the chunk in place and write it to secret file
+        if (decode_payload_chunk(decInfo, data, n, image) != e_success ||
+            fwrite(data, 1, n, decInfo->fptr_secret) != (size_t)n ||
+            checkpoint_progress(&decInfo->ckpt, decInfo->fptr_secret, data, n, done + n) != e_success)
+            ret = e_failure;
+        image += n * span;
+        done += n;
+    }
 
-        // Write decoded byte to secret file
-        if (fwrite(&ch, 1, 1, decInfo->fptr_secret) != 1)
-            return e_failure;
+    munmap(map, st.st_size);
+    free(data);
+    if (ret == e_success && fseek(decInfo->fptr_stego_image, end, SEEK_SET) != 0)
+        ret = e_failure;
+    return ret;
+}
+
+/* Decode secret file data with ECC
+ * Input: DecodeInfo structure
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Extracts the interleaved codewords, corrects them in memory and
+ * writes the recovered secret. Fails if any codeword has more
+ * damaged bytes than its parity can repair.
+ */
+Status decode_secret_file_data_ecc(DecodeInfo *decInfo)
+{
+    unsigned char *data = malloc(decInfo->size_secret_file + 1);
+    Status ret = e_failure;
+
+    if (data && decode_protected_buffer(data, decInfo->size_secret_file, decInfo) == e_success &&
+        fwrite(data, 1, decInfo->size_secret_file, decInfo->fptr_secret) == (size_t)decInfo->size_secret_file)
+        ret = e_success;
+
+    free(data);
+    return ret;
+}
+
+/* Decode secret file data with dedup
+ * Input: DecodeInfo structure
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Extracts the dedup container (ECC-corrected when --ecc was used)
+ * and rebuilds the secret from its chunk map before writing it.
+ */
+Status decode_secret_file_data_dedup(DecodeInfo *decInfo)
+{
+    unsigned char *container = malloc(decInfo->dedup_size + 1);
+    unsigned char *data = malloc(decInfo->size_secret_file + 1);
+    Status ret = e_failure;
+
+    if (container && data && decode_protected_buffer(container, decInfo->dedup_size, decInfo) == e_success)
+    {
+        if (dedup_decode(container, decInfo->dedup_size, data, decInfo->size_secret_file) != e_success)
+            printf("\033[1;36m❌ ERROR: Corrupt dedup chunk map\033[0m\n");
+        else if (fwrite(data, 1, decInfo->size_secret_file, decInfo->fptr_secret) == (size_t)decInfo->size_secret_file)
+            ret = e_success;
     }
 
+    free(container);
+    free(data);
+    return ret;
+}
+
+/* Decode protected buffer
+ * Input: Output buffer, byte count before ECC, DecodeInfo structure
+ * Output: Returns e_success or e_failure
+ * Description: Extracts size bytes, or their interleaved codewords
+ * corrected in memory when --ecc was used. Fails if any codeword has
+ * more damaged bytes than its parity can repair.
+ */
+Status decode_protected_buffer(unsigned char *data, long size, DecodeInfo *decInfo)
+{
+    if (!(decInfo->header_flags & STEGO_FLAG_ECC))
+        return decode_buffer_from_image(data, size, decInfo);
+
+    long stored_size = ecc_encoded_size(size, decInfo->ecc_nsym);
+    unsigned char *stored = malloc(stored_size + 1);
+    long corrected = 0;
+    Status ret = e_failure;
+
+    if (stored && decode_buffer_from_image(stored, stored_size, decInfo) == e_success)
+    {
+        if (rs_decode_interleaved(stored, size, decInfo->ecc_nsym, data, &corrected) != e_success)
+            printf("\033[1;36m❌ ERROR: Damage beyond ECC repair\033[0m\n");
+        else
+            ret = e_success;
+
+        if (corrected > 0)
+            printf("\033[1;36m🩹 ECC corrected %ld bytes\033[0m\n", corrected);
+    }
+
+    free(stored);
+    return ret;
+}
+
+/* Decode payload with O_DIRECT
+ * Input: Output buffer (NULL: write the secret file from the resume
+ *        point, with checkpoints), byte count, DecodeInfo structure
+ *        with the direct stream open
+ * Output: Returns e_success or e_failure
+ * Description: Chunks are decoded straight from the aligned window;
+ * the stego image never enters the page cache.
+ */
+Status decode_payload_direct(unsigned char *data, long size, DecodeInfo *decInfo)
+{
+    DirectStream *ds = &decInfo->direct;
+    long span = stego_payload_span(decInfo->header_flags), avail;
+    unsigned char *chunk = data ? NULL : malloc(STEGO_CHUNK_SIZE);
+    unsigned char *image;
+    Status ret = e_failure;
+
+    if ((data || chunk) && direct_start(ds, decInfo->fptr_stego_image, NULL) == e_success)
+        ret = e_success;
+
+    for (long done = data ? 0 : decInfo->ckpt.payload_done; ret == e_success && done < size; )
+    {
+        long n = size - done < STEGO_CHUNK_SIZE ? size - done : STEGO_CHUNK_SIZE;
+        unsigned char *out = chunk ? chunk : data + done;
+        if (direct_window(ds, n * span, &image, &avail) != e_success || avail < n * span ||
+            decode_payload_chunk(decInfo, out, n, image) != e_success ||
+            (chunk && (fwrite(chunk, 1, n, decInfo->fptr_secret) != (size_t)n ||
+                       checkpoint_progress(&decInfo->ckpt, decInfo->fptr_secret, chunk, n, done + n) != e_success)))
+            ret = e_failure;
+        ds->pos += n * span;
+        done += n;
+    }
+
+    if (ret == e_success)
+        ret = direct_finish(ds, decInfo->fptr_stego_image, NULL);
+
+    free(chunk);
+    return ret;
+}
+
+/* Decode buffer from image
+ * Input: Output buffer, byte count, DecodeInfo structure
+ * Output: Returns e_success or e_failure
+ * Description: Reads span image bytes (8, 4 in alpha mode, 12 or
+ * 30 with matrix embedding) per data byte, chunk by chunk.
+ */
+Status decode_buffer_from_image(unsigned char *data, long size, DecodeInfo *decInfo)
+{
+    if (decInfo->io_plan.strategy == e_io_direct)
+        return decode_payload_direct(data, size, decInfo);
+
+    long span = stego_payload_span(decInfo->header_flags);
+    unsigned char *buffer = malloc(STEGO_CHUNK_SIZE * span);
+    Status ret = buffer ? e_success : e_failure;
+
+    for (long done = 0; ret == e_success && done < size; )
+    {
+        long n = size - done < STEGO_CHUNK_SIZE ? size - done : STEGO_CHUNK_SIZE;
+        if (fread(buffer, 1, n * span, decInfo->fptr_stego_image) != (size_t)(n * span) ||
+            decode_payload_chunk(decInfo, data + done, n, buffer) != e_success)
+            ret = e_failure;
+        done += n;
+    }
+
+    free(buffer);
+    return ret;
+}
+
+/* Decode chunk from LSBs
+ * Input: Output buffer, byte count, image buffer of size * 8 bytes
+ * Output: Returns e_success
+ * Description: Rebuilds each byte from 8 consecutive image LSBs.
+ */
+Status decode_chunk_from_lsb(unsigned char *data, long size, const unsigned char *image_buffer)
+{
+    for (long i = 0; i < size; i++)
+        decode_byte_from_lsb((char *)data + i, (unsigned char *)image_buffer + i * 8);
+
     return e_success;
 }
 
+/* Decode chunk from alpha bytes
+ * Input: Output buffer, byte count, image buffer of size * 4 bytes
+ * Output: Returns e_success
+ * Description: Byte i is byte 4 * i + 3 of the image buffer. With
+ * SSE2, 64 image bytes are shifted down to their alpha byte per
+ * 32-bit lane and packed to 16 data bytes per step.
+ */
+Status decode_chunk_from_alpha(unsigned char *data, long size, const unsigned char *image_buffer)
+{
+    long i = 0;
+#ifdef __SSE2__
+    for (; i + 16 <= size; i += 16)
+    {
+        const __m128i *p = (const __m128i *)(image_buffer + i * STEGO_ALPHA_SPAN);
+        __m128i a0 = _mm_srli_epi32(_mm_loadu_si128(p), 24);
+        __m128i a1 = _mm_srli_epi32(_mm_loadu_si128(p + 1), 24);
+        __m128i a2 = _mm_srli_epi32(_mm_loadu_si128(p + 2), 24);
+        __m128i a3 = _mm_srli_epi32(_mm_loadu_si128(p + 3), 24);
+
+        // Lanes hold 0..255, so the saturating packs are exact
+        __m128i w0 = _mm_packs_epi32(a0, a1);
+        __m128i w1 = _mm_packs_epi32(a2, a3);
+        _mm_storeu_si128((__m128i *)(data + i), _mm_packus_epi16(w0, w1));
+    }
+#endif
+    for (; i < size; i++)
+        data[i] = image_buffer[i * STEGO_ALPHA_SPAN + 3];
+
+    return e_success;
+}
+
+/* Decode payload chunk
+ * Input: DecodeInfo (header decoded), output, count, image buffer
+ * Output: Returns e_success or e_failure
+ * Description: Picks the LSB, alpha or matrix kernel for this stego image.
+ */
+Status decode_payload_chunk(const DecodeInfo *decInfo, unsigned char *data, long size, const unsigned char *image_buffer)
+{
+    if (decInfo->header_flags & STEGO_FLAG_MATRIX)
+        return decode_chunk_matrix(data, size, image_buffer, STEGO_MATRIX_K(decInfo->header_flags));
+    if (decInfo->header_flags & STEGO_FLAG_ALPHA)
+        return decode_chunk_from_alpha(data, size, image_buffer);
+    return decode_chunk_from_lsb(data, size, image_buffer);
+}
+
 /* Decode data from image
  * Input: Output buffer, data size, and stego image file pointer
  * Output: Returns e_success or e_failure
@@ -3,6 +3,11 @@
 
 /* Contains user defined types */
 #include "types.h" 
+#include "options.h" // Optional switches
+#include "carrier.h" // Carrier format header layer
+#include "checkpoint.h" // Resumable output
+#include "io_strategy.h" // I/O planner
+#include "direct_io.h" // O_DIRECT streaming
 
 /* Maximum length for file extension */
 #define MAX_FILE_SUFFIX_ 50
@@ -15,6 +20,7 @@ typedef struct _DecodeInfo
     /* Stego Image Info */
     char stego_image_fname[1000];
     FILE *fptr_stego_image;
+    CarrierInfo carrier;
 
     /* Secret File Info */
     char secret_fname[1000];
@@ -22,6 +28,22 @@ typedef struct _DecodeInfo
     char extn_secret_file[MAX_FILE_SUFFIX_];
     long size_secret_file_extn;
     long size_secret_file;
+
+    /* Embedded header info */
+    uint header_version;
+    uint header_flags;
+    uint ecc_nsym;
+    long dedup_size;
+
+    /* Optional switches */
+    StegoOptions opts;
+
+    /* .part output and checkpoints (inactive for caller-opened streams) */
+    Checkpoint ckpt;
+
+    /* How the bytes are moved, chosen once the sizes are known */
+    IoPlan io_plan;
+    DirectStream direct;        /* Open while the plan is direct */
 } DecodeInfo;
 
 
@@ -36,8 +58,14 @@ Status read_and_validate_decode_args(int argc,char *argv[], DecodeInfo *decInfo)
 /* Perform the Decoding */
 Status do_decoding(DecodeInfo *decInfo);
 
-/* Skip bmp image header */
-Status skip_bmp_header(DecodeInfo *decInfo);
+/* Open the stego image and skip its carrier header */
+Status skip_carrier_header(DecodeInfo *decInfo);
+
+/* Read and validate the whole embedded header with one positioned read */
+Status decode_stego_header(DecodeInfo *decInfo);
+
+/* Append decoded extension to output name and create the output file */
+Status open_secret_file(DecodeInfo *decInfo);
 
 /* Decode Magic String */
 Status decode_magic_string(char * ,DecodeInfo *decInfo);
@@ -54,9 +82,39 @@ Status decode_secret_file_size(DecodeInfo *decInfo);
 /* Decode secret file data*/
 Status decode_secret_file_data(DecodeInfo *decInfo);
 
+/* Decode secret file data protected by Reed-Solomon parity */
+Status decode_secret_file_data_ecc(DecodeInfo *decInfo);
+
+/* Decode secret file data stored as a dedup container */
+Status decode_secret_file_data_dedup(DecodeInfo *decInfo);
+
+/* Extract size bytes, correcting them when the payload has ECC parity */
+Status decode_protected_buffer(unsigned char *data, long size, DecodeInfo *decInfo);
+
+/* Extract size bytes from the next size * 8 image bytes into a buffer */
+Status decode_buffer_from_image(unsigned char *data, long size, DecodeInfo *decInfo);
+
+/* Extract the payload (into data, or the secret file if NULL) with O_DIRECT */
+Status decode_payload_direct(unsigned char *data, long size, DecodeInfo *decInfo);
+
 /* Decode function, which does the real Decoding */
 Status decode_data_from_image(char *data, int size, FILE *fptr_src_image);
 
+/* Decode a chunk of size bytes from LSBs of size * 8 image bytes */
+Status decode_chunk_from_lsb(unsigned char *data, long size, const unsigned char *image_buffer);
+
+/* Extract size bytes stored whole in the alpha byte of 4-byte pixels */
+Status decode_chunk_from_alpha(unsigned char *data, long size, const unsigned char *image_buffer);
+
+/* Decode a chunk with the layout (LSB or alpha) of this stego image */
+Status decode_payload_chunk(const DecodeInfo *decInfo, unsigned char *data, long size, const unsigned char *image_buffer);
+
+/* Decode secret file data straight from a read-only mapping */
+Status decode_secret_file_data_mapped(DecodeInfo *decInfo);
+
+/* Decode secret file data with overlapped read / extract / write stages */
+Status decode_secret_file_data_pipelined(DecodeInfo *decInfo);
+
 /* Decode a byte from LSB of image data array */
 Status decode_byte_from_lsb(char *data, unsigned char *image_buffer);
 
@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "dedup.h"
+#include "stego_header.h"
+#include "types.h"
+
+/* Cut when the low bits of the gear hash are zero: 1 in DEDUP_AVG_CHUNK */
+#define DEDUP_MASK ((unsigned long long)(DEDUP_AVG_CHUNK - 1))
+
+/* One distinct chunk, found through an open-addressing table */
+typedef struct _DedupEntry
+{
+    unsigned long long hash;
+    long offset;
+    long length;
+    long index;         /* Order among the distinct chunks, -1 if free */
+} DedupEntry;
+
+static unsigned long long gear[256];
+static pthread_once_t gear_once = PTHREAD_ONCE_INIT;
+
+/* Function Definitions */
+
+/* Gear table: fixed pseudo-random values (splitmix64), the same on
+ * every build so cut points never change */
+static void build_gear_table(void)
+{
+    unsigned long long x = 0x5354454744454450ull;
+    for (int i = 0; i < 256; i++)
+    {
+        unsigned long long z = (x += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        gear[i] = z ^ (z >> 31);
+    }
+}
+
+/* Length of the chunk starting at data (size bytes left) */
+static long next_cut(const unsigned char *data, long size)
+{
+    if (size <= DEDUP_MIN_CHUNK)
+        return size;
+
+    long limit = size < DEDUP_MAX_CHUNK ? size : DEDUP_MAX_CHUNK;
+    unsigned long long h = 0;
+
+    // The hash only sees the last 64 bytes, so skipping ahead is safe
+    for (long i = DEDUP_MIN_CHUNK - 64; i < limit; i++)
+    {
+        h = (h << 1) + gear[data[i]];
+        if (i >= DEDUP_MIN_CHUNK && (h & DEDUP_MASK) == 0)
+            return i + 1;
+    }
+    return limit;
+}
+
+/* 64-bit hash of a chunk, 8 bytes per step */
+static unsigned long long chunk_hash(const unsigned char *data, long len)
+{
+    unsigned long long h = 0x9e3779b97f4a7c15ull ^ (unsigned long long)len;
+    long i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        unsigned long long w;
+        memcpy(&w, data + i, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+    for (; i < len; i++)
+        h = (h ^ data[i]) * 0x100000001b3ull;
+    return h ^ (h >> 29);
+}
+
+/* Dedup encode
+ * Input: Secret bytes, their count, container and size to fill, stats
+ * Output: Returns e_success or e_failure (out of memory)
+ * Description:
+ * Cuts the secret into content-defined chunks and looks each one up
+ * by hash; a hit is only taken as a repeat after the bytes compare
+ * equal, so a hash collision can never corrupt the payload.
+ */
+Status dedup_encode(const unsigned char *data, long size, unsigned char **out, long *out_size, DedupStats *stats)
+{
+    pthread_once(&gear_once, build_gear_table);
+
+    long max_chunks = size / DEDUP_MIN_CHUNK + 2;
+    long table_size = 16;
+    while (table_size < 2 * max_chunks)
+        table_size *= 2;
+
+    DedupEntry *table = malloc(table_size * sizeof(*table));
+    unsigned long long *map = malloc(max_chunks * sizeof(*map));
+    long *lengths = malloc(max_chunks * sizeof(*lengths));
+    unsigned char *container = malloc(size + max_chunks * 10 + 10);
+    Status ret = table && map && lengths && container ? e_success : e_failure;
+
+    long chunks = 0, unique = 0;
+    for (long i = 0; ret == e_success && i < table_size; i++)
+        table[i].index = -1;
+
+    for (long offset = 0; ret == e_success && offset < size; )
+    {
+        long len = next_cut(data + offset, size - offset);
+        unsigned long long hash = chunk_hash(data + offset, len);
+        long slot = hash & (table_size - 1);
+
+        while (table[slot].index >= 0 &&
+               (table[slot].hash != hash || table[slot].length != len ||
+                memcmp(data + table[slot].offset, data + offset, len) != 0))
+            slot = (slot + 1) & (table_size - 1);
+
+        lengths[chunks] = len;
+        if (table[slot].index >= 0)
+            map[chunks++] = ((unsigned long long)table[slot].index << 1) | 1;
+        else
+        {
+            table[slot].hash = hash;
+            table[slot].offset = offset;
+            table[slot].length = len;
+            table[slot].index = unique++;
+            map[chunks++] = (unsigned long long)len << 1;
+        }
+        offset += len;
+    }
+
+    if (ret == e_success)
+    {
+        // Map first, then the new chunks in order
+        long n = put_varint(container, chunks);
+        for (long c = 0; c < chunks; c++)
+            n += put_varint(container + n, map[c]);
+
+        long offset = 0;
+        for (long c = 0; c < chunks; c++)
+        {
+            if (!(map[c] & 1))
+            {
+                memcpy(container + n, data + offset, lengths[c]);
+                n += lengths[c];
+            }
+            offset += lengths[c];
+        }
+
+        *out = container;
+        *out_size = n;
+        stats->chunks = chunks;
+        stats->unique = unique;
+        container = NULL;
+    }
+
+    free(table);
+    free(map);
+    free(lengths);
+    free(container);
+    return ret;
+}
+
+/* Dedup decode
+ * Input: Container, its size, output buffer, expected size
+ * Output: Returns e_success or e_failure on a corrupt container
+ * Description: Every map entry and length is checked before use.
+ */
+Status dedup_decode(const unsigned char *container, long container_size, unsigned char *data, long size)
+{
+    unsigned long long chunks, entry;
+    int used = get_varint(container, container_size, &chunks);
+    // Every chunk holds at least one byte and one map byte
+    if (used == 0 || chunks > (unsigned long long)size || chunks > (unsigned long long)container_size)
+        return e_failure;
+
+    // Output offset and length of each new chunk, for repeats
+    long *offsets = malloc((chunks + 1) * sizeof(long));
+    long *lengths = malloc((chunks + 1) * sizeof(long));
+    Status ret = offsets && lengths ? e_success : e_failure;
+
+    // First pass: the map ends where the data part begins
+    long pos = used;
+    for (unsigned long long c = 0; ret == e_success && c < chunks; c++)
+    {
+        used = get_varint(container + pos, container_size - pos, &entry);
+        if (used == 0)
+            ret = e_failure;
+        pos += used;
+    }
+
+    long map_pos = get_varint(container, container_size, &chunks), data_pos = pos, out = 0, unique = 0;
+    for (unsigned long long c = 0; ret == e_success && c < chunks; c++)
+    {
+        map_pos += get_varint(container + map_pos, container_size - map_pos, &entry);
+        unsigned long long value = entry >> 1;
+
+        if (entry & 1)
+        {
+            // Repeat: copy from the output already rebuilt
+            if (value >= (unsigned long long)unique || lengths[value] > size - out)
+            {
+                ret = e_failure;
+                break;
+            }
+            memcpy(data + out, data + offsets[value], lengths[value]);
+            out += lengths[value];
+        }
+        else
+        {
+            if (value == 0 || value > (unsigned long long)(size - out) || value > (unsigned long long)(container_size - data_pos))
+            {
+                ret = e_failure;
+                break;
+            }
+            offsets[unique] = out;
+            lengths[unique++] = value;
+            memcpy(data + out, container + data_pos, value);
+            data_pos += value;
+            out += value;
+        }
+    }
+
+    if (ret == e_success && (out != size || data_pos != container_size))
+        ret = e_failure;
+
+    free(offsets);
+    free(lengths);
+    return ret;
+}
@@ -0,0 +1,45 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * Content-defined chunk deduplication of the payload.
+ *
+ * The secret is cut where a gear rolling hash of the last bytes
+ * matches a mask (chunks of DEDUP_MIN_CHUNK..DEDUP_MAX_CHUNK bytes,
+ * about DEDUP_AVG_CHUNK on average), so an insertion only moves the
+ * cuts next to it and repeated content yields repeated chunks.
+ * Chunks are hashed; a chunk equal to an earlier one is stored once.
+ *
+ * Container, embedded instead of the secret:
+ *
+ *   varint chunk count |
+ *   chunk map: one varint per chunk,
+ *     (length << 1)     new chunk, its bytes follow in the data part
+ *     (index << 1) | 1  repeat of the index-th new chunk |
+ *   data: the new chunks, in order
+ *
+ * The decoder rebuilds the secret by copying chunks.
+ */
+
+#define DEDUP_MIN_CHUNK 2048
+#define DEDUP_AVG_CHUNK 8192
+#define DEDUP_MAX_CHUNK 65536
+
+typedef struct _DedupStats
+{
+    long chunks;
+    long unique;
+} DedupStats;
+
+
+/* Dedup function prototype */
+
+/* Build the container for size bytes; *out is allocated */
+Status dedup_encode(const unsigned char *data, long size, unsigned char **out, long *out_size, DedupStats *stats);
+
+/* Rebuild exactly size bytes from a container */
+Status dedup_decode(const unsigned char *container, long container_size, unsigned char *data, long size);
+
+#endif
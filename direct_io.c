@@ -0,0 +1,201 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "direct_io.h"
+#include "types.h"
+
+#define ALIGN_DOWN(x) ((x) & ~(long long)(DIRECT_ALIGN - 1))
+#define ALIGN_UP(x) ALIGN_DOWN((x) + DIRECT_ALIGN - 1)
+
+/* Function Definitions */
+
+/* Reopen a stream's file with O_DIRECT, -1 if refused */
+static int reopen_direct(FILE *fptr, int flags)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", fileno(fptr));
+    return open(path, flags | O_DIRECT);
+}
+
+/* Read until len bytes or the end of file, offsets stay aligned */
+static Status read_full(DirectStream *ds, unsigned char *buf, long len, long long offset, long *got)
+{
+    *got = 0;
+    while (*got < len)
+    {
+        ssize_t n = pread(ds->fd_in, buf + *got, len - *got, offset + *got);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return e_failure;
+        if (n == 0 || n % DIRECT_ALIGN)
+        {
+            // Only the last block of the file is short
+            *got += n;
+            ds->eof = 1;
+            break;
+        }
+        *got += n;
+    }
+    return e_success;
+}
+
+/* Write len bytes (a multiple of DIRECT_ALIGN) at offset */
+static Status write_full(DirectStream *ds, const unsigned char *buf, long len, long long offset)
+{
+    for (long done = 0; done < len; )
+    {
+        ssize_t n = pwrite(ds->fd_out, buf + done, len - done, offset + done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return e_failure;
+        done += n;
+    }
+    return e_success;
+}
+
+/* Open direct stream
+ * Input: Stream, carrier (or stego) stream, output stream or NULL
+ * Output: Returns e_success or e_failure when O_DIRECT is refused
+ * Description: Some filesystems (tmpfs, many FUSE mounts) refuse
+ * O_DIRECT; the caller then keeps to buffered I/O.
+ */
+Status direct_open(DirectStream *ds, FILE *in, FILE *out)
+{
+    void *window = NULL;
+
+    memset(ds, 0, sizeof(*ds));
+    ds->fd_in = reopen_direct(in, O_RDONLY);
+    ds->fd_out = out ? reopen_direct(out, O_RDWR) : -1;
+
+    // One spare block after the window for reading back the head
+    if (ds->fd_in < 0 || (out && ds->fd_out < 0) ||
+        posix_memalign(&window, DIRECT_ALIGN, DIRECT_WINDOW + DIRECT_ALIGN) != 0)
+    {
+        if (ds->fd_in >= 0)
+            close(ds->fd_in);
+        if (ds->fd_out >= 0)
+            close(ds->fd_out);
+        ds->window = NULL;
+        return e_failure;
+    }
+    ds->window = window;
+    return e_success;
+}
+
+/* Start direct stream
+ * Input: Opened stream, the stdio streams positioned at the payload
+ * Output: Returns e_success or e_failure
+ * Description:
+ * The window starts at the aligned offset at or below the payload.
+ * For an encode the bytes from there to the payload are already in
+ * the output (written through stdio), so they are read back from it
+ * and the first aligned write carries them unchanged.
+ */
+Status direct_start(DirectStream *ds, FILE *in, FILE *out)
+{
+    long long pos = ftell(in);
+    long head;
+
+    if (pos < 0 || (out && (fflush(out) != 0 || ftell(out) != pos)))
+        return e_failure;
+
+    ds->pos = pos;
+    ds->base = ALIGN_DOWN(pos);
+    ds->eof = 0;
+    head = pos - ds->base;
+
+    if (read_full(ds, ds->window, DIRECT_WINDOW, ds->base, &ds->len) != e_success || ds->len < head)
+        return e_failure;
+    if (out && head > 0)
+    {
+        unsigned char *spare = ds->window + DIRECT_WINDOW;
+        if (pread(ds->fd_out, spare, DIRECT_ALIGN, ds->base) < head)
+            return e_failure;
+        memcpy(ds->window, spare, head);
+    }
+    return e_success;
+}
+
+/* Direct window
+ * Input: Stream, bytes wanted at pos, pointer and count to fill
+ * Output: Returns e_success or e_failure on an I/O error
+ * Description:
+ * When fewer than need bytes are left in the window, the aligned
+ * part before pos is written (encode) and dropped, the block holding
+ * pos moves to the front and the window is filled up again.
+ */
+Status direct_window(DirectStream *ds, long need, unsigned char **at, long *avail)
+{
+    if (ds->pos + need > ds->base + ds->len && !ds->eof)
+    {
+        long long keep_from = ALIGN_DOWN(ds->pos);
+        long drop = keep_from - ds->base, keep = ds->len - drop, got;
+
+        if (ds->fd_out >= 0 && drop > 0 && write_full(ds, ds->window, drop, ds->base) != e_success)
+            return e_failure;
+
+        memmove(ds->window, ds->window + drop, keep);
+        ds->base = keep_from;
+        if (read_full(ds, ds->window + keep, DIRECT_WINDOW - keep, ds->base + keep, &got) != e_success)
+            return e_failure;
+        ds->len = keep + got;
+    }
+
+    *at = ds->window + (ds->pos - ds->base);
+    *avail = ds->base + ds->len - ds->pos;
+    return e_success;
+}
+
+/* Finish direct stream
+ * Input: Stream, the stdio streams
+ * Output: Returns e_success or e_failure
+ * Description:
+ * For an encode the rest of the carrier is copied unchanged; the
+ * last, unaligned block is written zero-padded and the output is
+ * truncated back to the carrier's size. The stdio streams are left
+ * after pos, where the buffered path would have left them.
+ */
+Status direct_finish(DirectStream *ds, FILE *in, FILE *out)
+{
+    unsigned char *at;
+    long avail;
+
+    if (ds->fd_out >= 0)
+    {
+        // Pull the rest of the carrier through the window
+        do
+        {
+            if (direct_window(ds, DIRECT_WINDOW, &at, &avail) != e_success)
+                return e_failure;
+            ds->pos += avail;
+        } while (!ds->eof);
+
+        long padded = ALIGN_UP((long long)ds->len);
+        memset(ds->window + ds->len, 0, padded - ds->len);
+        if (write_full(ds, ds->window, padded, ds->base) != e_success ||
+            ftruncate(ds->fd_out, ds->base + ds->len) != 0)
+            return e_failure;
+    }
+
+    if (fseek(in, ds->pos, SEEK_SET) != 0 || (out && fseek(out, ds->pos, SEEK_SET) != 0))
+        return e_failure;
+    return e_success;
+}
+
+/* Close direct stream */
+void direct_close(DirectStream *ds)
+{
+    if (ds->window == NULL)
+        return;
+    free(ds->window);
+    close(ds->fd_in);
+    if (ds->fd_out >= 0)
+        close(ds->fd_out);
+    ds->window = NULL;
+}
@@ -0,0 +1,60 @@
+#ifndef DIRECT_IO_H
+#define DIRECT_IO_H
+
+#include <stdio.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * O_DIRECT streaming of the carrier (--direct).
+ *
+ * The carrier and the output are reopened with O_DIRECT and moved
+ * through one page-aligned window, so multi-GB jobs neither fill
+ * the page cache nor stall in writeback. Every read and write is at
+ * an aligned offset and of an aligned length:
+ *
+ *   - the window starts at the aligned offset at or below the
+ *     payload; the unaligned head before the payload (carrier header
+ *     and embedded header, written through stdio) is read back from
+ *     the output into the window
+ *   - when the window runs out, the aligned part before the current
+ *     position is written and the rest (the block holding a payload
+ *     byte's carrier bytes that straddle the end) moves to the front
+ *   - the unaligned tail is written zero-padded to a whole block and
+ *     the output is truncated to the carrier's size
+ *
+ * Memory use is one DIRECT_WINDOW whatever the carrier size.
+ */
+
+#define DIRECT_ALIGN 4096
+#define DIRECT_WINDOW (8L * 1024 * 1024)
+
+typedef struct _DirectStream
+{
+    unsigned char *window;      /* DIRECT_WINDOW bytes and a spare block, aligned; NULL when closed */
+    int fd_in;
+    int fd_out;                 /* -1 when only reading (decode) */
+    long long base;             /* File offset of window[0], aligned */
+    long len;                   /* Valid bytes in the window */
+    long long pos;              /* Next byte to process */
+    int eof;                    /* Carrier read to the end */
+} DirectStream;
+
+
+/* Direct I/O function prototype */
+
+/* Reopen in (and out, or NULL) with O_DIRECT; e_failure if refused */
+Status direct_open(DirectStream *ds, FILE *in, FILE *out);
+
+/* Fill the window from the streams' current position */
+Status direct_start(DirectStream *ds, FILE *in, FILE *out);
+
+/* Make need bytes at pos available (fewer only at the end of file) */
+Status direct_window(DirectStream *ds, long need, unsigned char **at, long *avail);
+
+/* Encode: copy the rest and truncate; place the streams after pos */
+Status direct_finish(DirectStream *ds, FILE *in, FILE *out);
+
+/* Free the window and close the descriptors */
+void direct_close(DirectStream *ds);
+
+#endif
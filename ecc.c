@@ -0,0 +1,390 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "ecc.h"
+#include "types.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define GF_HAVE_SSSE3 1
+#endif
+
+/* Region operations shared by the scalar and SIMD kernels */
+#define GF_OP_MUL 0     /* dst = c * src */
+#define GF_OP_XOR 1     /* dst ^= c * src */
+#define GF_OP_HORNER 2  /* dst = c * dst ^ src */
+
+static unsigned char gf_exp[512];
+static unsigned char gf_log[256];
+static pthread_once_t gf_once = PTHREAD_ONCE_INIT;
+static void (*gf_region)(unsigned char *, const unsigned char *, unsigned char, long, int);
+
+/* Function Definitions */
+
+unsigned char gf_mul(unsigned char a, unsigned char b)
+{
+    if (a == 0 || b == 0)
+        return 0;
+    return gf_exp[gf_log[a] + gf_log[b]];
+}
+
+static unsigned char gf_div(unsigned char a, unsigned char b)
+{
+    if (a == 0)
+        return 0;
+    return gf_exp[(gf_log[a] + 255 - gf_log[b]) % 255];
+}
+
+/* Scalar region kernel: one 256-entry product row for constant c */
+static void gf_region_scalar(unsigned char *dst, const unsigned char *src, unsigned char c, long len, int op)
+{
+    unsigned char row[256];
+    for (int x = 0; x < 256; x++)
+        row[x] = gf_mul(c, x);
+
+    for (long i = 0; i < len; i++)
+    {
+        if (op == GF_OP_MUL)
+            dst[i] = row[src[i]];
+        else if (op == GF_OP_XOR)
+            dst[i] ^= row[src[i]];
+        else
+            dst[i] = row[dst[i]] ^ src[i];
+    }
+}
+
+#ifdef GF_HAVE_SSSE3
+/* SSSE3 region kernel
+ * c * v = c * (v & 0x0f) ^ c * (v & 0xf0), each half looked up
+ * in a 16-entry table with pshufb, 16 bytes per step.
+ */
+__attribute__((target("ssse3")))
+static void gf_region_ssse3(unsigned char *dst, const unsigned char *src, unsigned char c, long len, int op)
+{
+    unsigned char lo[16], hi[16];
+    for (int i = 0; i < 16; i++)
+    {
+        lo[i] = gf_mul(c, i);
+        hi[i] = gf_mul(c, i << 4);
+    }
+
+    const __m128i table_lo = _mm_loadu_si128((const __m128i *)lo);
+    const __m128i table_hi = _mm_loadu_si128((const __m128i *)hi);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+
+    long i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i v = op == GF_OP_HORNER ? d : s;
+        __m128i p = _mm_xor_si128(_mm_shuffle_epi8(table_lo, _mm_and_si128(v, nibble)),
+                                  _mm_shuffle_epi8(table_hi, _mm_and_si128(_mm_srli_epi64(v, 4), nibble)));
+        if (op == GF_OP_XOR)
+            p = _mm_xor_si128(p, d);
+        else if (op == GF_OP_HORNER)
+            p = _mm_xor_si128(p, s);
+        _mm_storeu_si128((__m128i *)(dst + i), p);
+    }
+    if (i < len)
+        gf_region_scalar(dst + i, src + i, c, len - i, op);
+}
+#endif
+
+/* Build tables once and choose the region kernel for this CPU */
+static void gf_build_tables(void)
+{
+    unsigned x = 1;
+    for (int i = 0; i < 255; i++)
+    {
+        gf_exp[i] = x;
+        gf_log[x] = i;
+        x <<= 1;
+        if (x & 0x100)
+            x ^= 0x11d;
+    }
+    // Doubled so gf_mul never needs a modulo
+    for (int i = 255; i < 512; i++)
+        gf_exp[i] = gf_exp[i - 255];
+
+    gf_region = gf_region_scalar;
+#ifdef GF_HAVE_SSSE3
+    if (__builtin_cpu_supports("ssse3"))
+        gf_region = gf_region_ssse3;
+#endif
+}
+
+void gf_init(void)
+{
+    pthread_once(&gf_once, gf_build_tables);
+}
+
+void gf_mul_region(unsigned char *dst, const unsigned char *src, unsigned char c, long len)
+{
+    gf_region(dst, src, c, len, GF_OP_MUL);
+}
+
+void gf_mul_region_xor(unsigned char *dst, const unsigned char *src, unsigned char c, long len)
+{
+    gf_region(dst, src, c, len, GF_OP_XOR);
+}
+
+void gf_horner_region(unsigned char *acc, const unsigned char *src, unsigned char c, long len)
+{
+    gf_region(acc, src, c, len, GF_OP_HORNER);
+}
+
+/* ECC layout
+ * Input: Data size, parity bytes per codeword
+ * Output: Codeword count and data bytes per codeword
+ * Description: As few codewords as fit in 255 bytes, with the
+ * data spread evenly so only the last few carry a zero pad byte.
+ */
+void ecc_layout(long size, int nsym, long *ncw, long *k)
+{
+    long kmax = 255 - nsym;
+    *ncw = (size + kmax - 1) / kmax;
+    *k = *ncw ? (size + *ncw - 1) / *ncw : 0;
+}
+
+long ecc_encoded_size(long size, int nsym)
+{
+    long ncw, k;
+    ecc_layout(size, nsym, &ncw, &k);
+    return ncw * (k + nsym);
+}
+
+/* Generator polynomial g(x) = (x + a^0)(x + a^1)...(x + a^(nsym-1)),
+ * g[j] is the coefficient of x^j, g[nsym] = 1 */
+static void rs_generator(int nsym, unsigned char *g)
+{
+    memset(g, 0, nsym + 1);
+    g[0] = 1;
+    for (int i = 0; i < nsym; i++)
+    {
+        // Multiply by (x + a^i)
+        for (int j = i + 1; j > 0; j--)
+            g[j] = g[j - 1] ^ gf_mul(g[j], gf_exp[i]);
+        g[0] = gf_mul(g[0], gf_exp[i]);
+    }
+}
+
+/* RS encode interleaved
+ * Input: Data bytes, size, parity bytes per codeword, output buffer
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Writes the data symbol-major (row pos holds byte pos of every
+ * codeword), then runs the systematic encoder LFSR on all
+ * codewords at once: each step is a row XOR plus nsym region
+ * multiplies. The parity rows follow the data rows.
+ */
+Status rs_encode_interleaved(const unsigned char *data, long size, int nsym, unsigned char *out)
+{
+    long ncw, k;
+    unsigned char g[ECC_MAX_NSYM + 1];
+
+    if (nsym < 2 || nsym > ECC_MAX_NSYM)
+        return e_failure;
+    gf_init();
+    ecc_layout(size, nsym, &ncw, &k);
+    if (ncw == 0)
+        return e_success;
+
+    // Interleave data, codeword c holds data[c * k .. c * k + k - 1]
+    for (long c = 0; c < ncw; c++)
+        for (long pos = 0; pos < k; pos++)
+        {
+            long t = c * k + pos;
+            out[pos * ncw + c] = t < size ? data[t] : 0;
+        }
+
+    unsigned char *regs = calloc((size_t)(nsym + 1) * ncw, 1);
+    unsigned char *r[ECC_MAX_NSYM];
+    if (regs == NULL)
+        return e_failure;
+    unsigned char *fb = regs + (size_t)nsym * ncw;
+    for (int j = 0; j < nsym; j++)
+        r[j] = regs + (size_t)j * ncw;
+
+    rs_generator(nsym, g);
+    for (long pos = 0; pos < k; pos++)
+    {
+        const unsigned char *row = out + pos * ncw;
+        for (long c = 0; c < ncw; c++)
+            fb[c] = row[c] ^ r[nsym - 1][c];
+
+        // Shift registers up one degree, reusing the consumed top one
+        unsigned char *top = r[nsym - 1];
+        for (int j = nsym - 1; j > 0; j--)
+            r[j] = r[j - 1];
+        r[0] = top;
+
+        gf_mul_region(r[0], fb, g[0], ncw);
+        for (int j = 1; j < nsym; j++)
+            gf_mul_region_xor(r[j], fb, g[j], ncw);
+    }
+
+    // Parity rows, highest degree first
+    for (int t = 0; t < nsym; t++)
+        memcpy(out + (k + t) * ncw, r[nsym - 1 - t], ncw);
+
+    free(regs);
+    return e_success;
+}
+
+/* Evaluate polynomial p (p[i] is the coefficient of x^i) at x */
+static unsigned char poly_eval(const unsigned char *p, int degree, unsigned char x)
+{
+    unsigned char y = 0;
+    for (int i = degree; i >= 0; i--)
+        y = gf_mul(y, x) ^ p[i];
+    return y;
+}
+
+/* Correct codeword
+ * Input: Codeword (highest degree first), length, syndromes, nsym
+ * Output: Number of corrected bytes, -1 if uncorrectable
+ * Description: Berlekamp-Massey for the error locator, Chien
+ * search for the positions and Forney for the magnitudes.
+ */
+static int rs_correct_codeword(unsigned char *cw, int n, const unsigned char *synd, int nsym)
+{
+    unsigned char C[ECC_MAX_NSYM + 1] = {1}, B[ECC_MAX_NSYM + 1] = {1}, T[ECC_MAX_NSYM + 1];
+    int L = 0, m = 1;
+    unsigned char b = 1;
+
+    for (int i = 0; i < nsym; i++)
+    {
+        unsigned char d = synd[i];
+        for (int j = 1; j <= L; j++)
+            d ^= gf_mul(C[j], synd[i - j]);
+
+        if (d == 0)
+        {
+            m++;
+            continue;
+        }
+
+        unsigned char coef = gf_div(d, b);
+        memcpy(T, C, sizeof(C));
+        for (int j = 0; j + m <= nsym; j++)
+            C[j + m] ^= gf_mul(coef, B[j]);
+
+        if (2 * L <= i)
+        {
+            L = i + 1 - L;
+            memcpy(B, T, sizeof(B));
+            b = d;
+            m = 1;
+        }
+        else
+            m++;
+    }
+
+    if (2 * L > nsym)
+        return -1;
+
+    // Omega(x) = S(x) * Lambda(x) mod x^nsym
+    unsigned char omega[ECC_MAX_NSYM] = {0};
+    for (int i = 0; i < nsym; i++)
+        for (int j = 0; j <= i && j <= L; j++)
+            omega[i] ^= gf_mul(synd[i - j], C[j]);
+
+    // Formal derivative keeps odd powers only
+    unsigned char deriv[ECC_MAX_NSYM] = {0};
+    for (int i = 1; i <= L; i += 2)
+        deriv[i - 1] = C[i];
+
+    int found = 0;
+    for (int pos = 0; pos < n; pos++)
+    {
+        int e = n - 1 - pos;
+        unsigned char x_inv = gf_exp[(255 - e) % 255];
+        if (poly_eval(C, L, x_inv) != 0)
+            continue;
+
+        unsigned char den = poly_eval(deriv, L, x_inv);
+        if (den == 0)
+            return -1;
+        cw[pos] ^= gf_mul(gf_exp[e], gf_div(poly_eval(omega, nsym - 1, x_inv), den));
+        found++;
+    }
+    if (found != L)
+        return -1;
+
+    // Reject miscorrections: the result must be a codeword
+    for (int i = 0; i < nsym; i++)
+    {
+        unsigned char s = 0;
+        for (int pos = 0; pos < n; pos++)
+            s = gf_mul(s, gf_exp[i]) ^ cw[pos];
+        if (s != 0)
+            return -1;
+    }
+    return found;
+}
+
+/* RS decode interleaved
+ * Input: Stored bytes (corrected in place), data size, nsym, output
+ * Output: Returns e_success, or e_failure if a codeword is beyond
+ *         repair; corrected receives the number of fixed bytes
+ * Description:
+ * Syndromes of all codewords are computed together with one Horner
+ * region step per row and syndrome. Only codewords with a nonzero
+ * syndrome go through the scalar correction.
+ */
+Status rs_decode_interleaved(unsigned char *stored, long size, int nsym, unsigned char *data, long *corrected)
+{
+    long ncw, k;
+
+    *corrected = 0;
+    if (nsym < 2 || nsym > ECC_MAX_NSYM)
+        return e_failure;
+    gf_init();
+    ecc_layout(size, nsym, &ncw, &k);
+    if (ncw == 0)
+        return e_success;
+
+    int n = k + nsym;
+    unsigned char *synd = calloc((size_t)nsym * ncw, 1);
+    if (synd == NULL)
+        return e_failure;
+
+    for (int pos = 0; pos < n; pos++)
+        for (int i = 0; i < nsym; i++)
+            gf_horner_region(synd + (size_t)i * ncw, stored + (size_t)pos * ncw, gf_exp[i], ncw);
+
+    Status ret = e_success;
+    unsigned char cw[255], s[ECC_MAX_NSYM];
+    for (long c = 0; c < ncw; c++)
+    {
+        int dirty = 0;
+        for (int i = 0; i < nsym; i++)
+        {
+            s[i] = synd[(size_t)i * ncw + c];
+            dirty |= s[i];
+        }
+        if (!dirty)
+            continue;
+
+        for (int pos = 0; pos < n; pos++)
+            cw[pos] = stored[(size_t)pos * ncw + c];
+
+        int fixed = rs_correct_codeword(cw, n, s, nsym);
+        if (fixed < 0)
+        {
+            ret = e_failure;
+            continue;
+        }
+        *corrected += fixed;
+        for (int pos = 0; pos < n; pos++)
+            stored[(size_t)pos * ncw + c] = cw[pos];
+    }
+    free(synd);
+
+    // De-interleave the data rows
+    for (long t = 0; t < size; t++)
+        data[t] = stored[(t % k) * ncw + t / k];
+    return ret;
+}
@@ -0,0 +1,56 @@
+#ifndef ECC_H
+#define ECC_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * Reed-Solomon error correction over GF(256), poly 0x11d.
+ *
+ * The protected data is split into ncw codewords of k data bytes
+ * and nsym parity bytes (k + nsym <= 255) and stored symbol-major:
+ * byte pos of every codeword, then byte pos + 1 of every codeword,
+ * and so on. A run of flipped carrier bytes therefore lands in many
+ * codewords with at most a byte or two each. The same layout makes
+ * every encode and syndrome step one GF multiply over a contiguous
+ * row of ncw bytes, which the region kernels vectorise (SSSE3
+ * nibble tables when the CPU has them, log/exp tables otherwise).
+ */
+
+#define ECC_DEFAULT_NSYM 16
+#define ECC_MAX_NSYM 128
+
+/* The ECC header is one shortened codeword of this shape */
+#define ECC_HEADER_DATA 68
+#define ECC_HEADER_PARITY 28
+
+
+/* ECC function prototype */
+
+/* Build log/exp tables and pick region kernels (thread safe, idempotent) */
+void gf_init(void);
+
+/* Multiply two field elements */
+unsigned char gf_mul(unsigned char a, unsigned char b);
+
+/* dst[i] = c * src[i] */
+void gf_mul_region(unsigned char *dst, const unsigned char *src, unsigned char c, long len);
+
+/* dst[i] ^= c * src[i] */
+void gf_mul_region_xor(unsigned char *dst, const unsigned char *src, unsigned char c, long len);
+
+/* acc[i] = c * acc[i] ^ src[i] (one Horner step) */
+void gf_horner_region(unsigned char *acc, const unsigned char *src, unsigned char c, long len);
+
+/* Number of codewords and data bytes per codeword for size bytes */
+void ecc_layout(long size, int nsym, long *ncw, long *k);
+
+/* Stored (interleaved, with parity) size for size data bytes */
+long ecc_encoded_size(long size, int nsym);
+
+/* Encode size bytes into ecc_encoded_size() interleaved bytes */
+Status rs_encode_interleaved(const unsigned char *data, long size, int nsym, unsigned char *out);
+
+/* Correct stored bytes in place and extract the size data bytes */
+Status rs_decode_interleaved(unsigned char *stored, long size, int nsym, unsigned char *data, long *corrected);
+
+#endif
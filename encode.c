@@ -2,10 +2,49 @@
 #include "encode.h"
 #include "types.h"
 #include <string.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include "common.h"
+#include "stego_header.h"
+#include "ecc.h"
+#include "matrix.h"
+#include "dedup.h"
+#include "result_cache.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /* Function Definitions */
 
+/* Read BMP geometry
+ * Input: Image file ptr
+ * Output: width, height and bits per pixel from the BMP header
+ * Description: Reads only the header fields (offset 18 for width and
+ * height, offset 28 for bits per pixel) so callers can size a carrier
+ * without touching its pixel data.
+ */
+Status read_bmp_geometry(FILE *fptr_image, uint *width, uint *height, uint *bits_per_pixel)
+{
+    unsigned short bpp = 0;
+
+    // Seek to 18th byte and read width and height
+    if (fseek(fptr_image, 18, SEEK_SET) != 0)
+        return e_failure;
+    if (fread(width, sizeof(int), 1, fptr_image) != 1)
+        return e_failure;
+    if (fread(height, sizeof(int), 1, fptr_image) != 1)
+        return e_failure;
+
+    // Bits per pixel is a 2 byte field at offset 28
+    if (fseek(fptr_image, 28, SEEK_SET) != 0)
+        return e_failure;
+    if (fread(&bpp, sizeof(bpp), 1, fptr_image) != 1)
+        return e_failure;
+
+    *bits_per_pixel = bpp;
+    return e_success;
+}
+
 /* Get image size
  * Input: Image file ptr
  * Output: width * height * bytes per pixel (3 in our case)
@@ -14,13 +53,11 @@
  */
 uint get_image_size_for_bmp(FILE *fptr_image)
 {
-    uint width, height;
-    // Seek to 18th byte
-    fseek(fptr_image, 18, SEEK_SET);
+    uint width, height, bpp;
 
-    // Read the width (an int)
-    fread(&width, sizeof(int), 1, fptr_image);
-    fread(&height, sizeof(int), 1, fptr_image);
+    // Read the width, height and bits per pixel
+    if (read_bmp_geometry(fptr_image, &width, &height, &bpp) != e_success)
+        return 0;
 
     printf("\033[1;36m🖥️  Image dimensions: %u x %u pixels.\033[0m\n", width, height);
     
@@ -28,6 +65,86 @@ uint get_image_size_for_bmp(FILE *fptr_image)
     return width * height * 3;
 }
 
+/* Header version an encode with these options writes */
+static uint stego_job_version(const StegoOptions *opts)
+{
+    return (opts->flags & OPT_LEGACY_HEADER) ? STEGO_HEADER_V1 : STEGO_HEADER_V2;
+}
+
+/* Header flags an encode with these options writes */
+static uint stego_job_flags(const StegoOptions *opts)
+{
+    uint flags = 0;
+    if (opts->flags & OPT_DEDUP)
+        flags |= STEGO_FLAG_DEDUP;
+    if (opts->flags & OPT_ECC)
+        flags |= STEGO_FLAG_ECC;
+    if (opts->flags & OPT_ALPHA)
+        flags |= STEGO_FLAG_ALPHA;
+    if (opts->flags & OPT_MATRIX)
+        flags |= STEGO_FLAG_MATRIX | (opts->matrix_k << STEGO_MATRIX_K_SHIFT);
+    return flags;
+}
+
+/* Carrier bytes taken by a header of header_length and the payload after it */
+static long long stego_span_bytes(uint header_length, uint flags, long size_embedded)
+{
+    return (long long)header_length * stego_payload_span(stego_header_layout(flags)) +
+           (long long)size_embedded * stego_payload_span(flags);
+}
+
+/* Get usable capacity
+ * Input: Probed carrier, options
+ * Output: Carrier bytes the payload may use, 0 if the options
+ * cannot embed into this carrier
+ * Description: --alpha needs every pixel to be 4 bytes with no
+ * row padding, so byte 4 * i + 3 of the stream is always alpha.
+ */
+long long get_usable_capacity(const CarrierInfo *carrier, const StegoOptions *opts)
+{
+    if (!(opts->flags & OPT_ALPHA))
+        return carrier->capacity;
+    if (carrier->bytes_per_pixel != 4 || carrier->stride != carrier->width * 4)
+        return 0;
+    return (long long)carrier->width * carrier->height * STEGO_ALPHA_SPAN;
+}
+
+/* Get required capacity
+ * Input: Secret file extension, secret file size, options
+ * Output: Carrier bytes an encode with these options needs,
+ * 0 if the options or the secret cannot be encoded
+ * Description: Same header and spans as check_capacity. Dedup
+ * is only known after reading the secret and never grows it,
+ * so the secret is counted at full size.
+ */
+long long get_required_capacity(const char *extn, long size_secret_file, const StegoOptions *opts)
+{
+    StegoHeader hdr = {0};
+    unsigned char buf[STEGO_HEADER_MAX];
+
+    hdr.version = stego_job_version(opts);
+    hdr.flags = stego_job_flags(opts);
+    if ((hdr.version == STEGO_HEADER_V1 && hdr.flags) ||
+        ((hdr.flags & STEGO_FLAG_ALPHA) && (hdr.flags & STEGO_FLAG_MATRIX)))
+        return 0;
+
+    long size_embedded = size_secret_file;
+    if (hdr.flags & STEGO_FLAG_DEDUP)
+        hdr.dedup_size = size_secret_file;
+    if (hdr.flags & STEGO_FLAG_ECC)
+    {
+        hdr.ecc_nsym = opts->ecc_nsym;
+        size_embedded = ecc_encoded_size(size_embedded, hdr.ecc_nsym);
+    }
+    snprintf(hdr.extn_secret_file, sizeof(hdr.extn_secret_file), "%s", extn);
+    hdr.size_secret_file = size_secret_file;
+
+    uint header_length = build_stego_header(&hdr, buf);
+    if (header_length == 0)
+        return 0;
+    return stego_span_bytes(header_length, hdr.flags, size_embedded);
+}
+
 /* Get file size
  * Input: File pointer fptr
  * Output: Size of the file in bytes
@@ -35,7 +152,7 @@ uint get_image_size_for_bmp(FILE *fptr_image)
  * Moves the file pointer to the end to determine the file size using ftell(),
  * then resets the pointer back to the beginning of the file.
  */
-uint get_file_size(FILE *fptr)
+long get_file_size(FILE *fptr)
 {
     // Move the file pointer to the end of the file
     fseek(fptr,0,SEEK_END);
@@ -56,11 +173,14 @@ uint get_file_size(FILE *fptr)
  * Stego Image file
  * Output: FILE pointer for above files
  * Return Value: e_success or e_failure, on file errors
+ * Note: Files already opened by the caller (e.g. from descriptors
+ * handed to the daemon) are left as they are.
  */
 Status open_files(EncodeInfo *encInfo)
 {
     // Src Image file
-    encInfo->fptr_src_image = fopen(encInfo->src_image_fname, "rb");
+    if (encInfo->fptr_src_image == NULL)
+        encInfo->fptr_src_image = fopen(encInfo->src_image_fname, "rb");
     // Do Error handling
     if (encInfo->fptr_src_image == NULL)
     {
@@ -70,7 +190,8 @@ Status open_files(EncodeInfo *encInfo)
     }
 
     // Secret file
-    encInfo->fptr_secret = fopen(encInfo->secret_fname, "rb");
+    if (encInfo->fptr_secret == NULL)
+        encInfo->fptr_secret = fopen(encInfo->secret_fname, "rb");
     // Do Error handling
     if (encInfo->fptr_secret == NULL)
     {
@@ -79,8 +200,12 @@ Status open_files(EncodeInfo *encInfo)
         return e_failure;
     }
 
-    // Stego Image file
-    encInfo->fptr_stego_image = fopen(encInfo->stego_image_fname, "wb");
+    // Stego Image file, written as "<name>.part" until complete
+    if (encInfo->fptr_stego_image == NULL)
+    {
+        checkpoint_init(&encInfo->ckpt, encInfo->stego_image_fname);
+        encInfo->fptr_stego_image = checkpoint_open_output(&encInfo->ckpt, encInfo->opts.flags & OPT_RESUME);
+    }
     // Do Error handling
     if (encInfo->fptr_stego_image == NULL)
     {
@@ -100,25 +225,29 @@ Status open_files(EncodeInfo *encInfo)
  * Input: argc, argv, EncodeInfo structure
  * Output: Fills EncodeInfo with valid file names
  * Description: 
- * Checks argument count, validates .bmp files, extracts secret file extension,
- * and sets default output name if not given.
+ * Checks argument count, validates carrier file names, extracts secret file extension,
+ * and sets default output name if not given. Options ("--pipeline")
+ * may follow the positional arguments.
  */
 Status read_and_validate_encode_args(int argc,char *argv[] , EncodeInfo *encInfo)
 {
-    // Check argument count (should be 4 or 6)
-    if (argc != 4 && argc != 6)  
+    // Strip "--" options first, positional layout stays the same
+    if (parse_stego_options(&argc, argv, &encInfo->opts) != e_success)
+        return e_failure;
+
+    // Check argument count (4 or 5, optional stego name)
+    if (argc < 4 || argc > 6)  
         return e_failure;
 
-    // Validate source image file (must end with .bmp)
-    int len = strlen(argv[2]) ;
-    if (len < 4 || strcmp(argv[2] + len - 4,".bmp") != 0) 
+    // Validate source image file (.bmp, .ppm, .pam, .raw or --raw)
+    if (carrier_format_from_name(argv[2], &encInfo->opts, &encInfo->carrier.format) != e_success)
         return e_failure;
     else 
         encInfo->src_image_fname = argv[2];
 
     // Validate and store secret file details
     char *dot = strchr(argv[3], '.') ;
-    if (dot != NULL)
+    if (dot != NULL && strlen(dot) < MAX_FILE_SUFFIX)
     {
         strcpy(encInfo->extn_secret_file , dot);
         encInfo->secret_fname = argv[3];
@@ -127,35 +256,134 @@ Status read_and_validate_encode_args(int argc,char *argv[] , EncodeInfo *encInfo
         return e_failure;
 
     // Set stego image file name (default or user-provided)
-    if (argc == 6)
+    // The stego image keeps the carrier's format
+    if (argc >= 5)
     {
-        len = strlen(argv[4]);
-        if (len < 4 || strcmp(argv[4] + len - 4, ".bmp") != 0)
+        CarrierFormat format;
+        if (carrier_format_from_name(argv[4], &encInfo->opts, &format) != e_success || format != encInfo->carrier.format)
             return e_failure;
         encInfo->stego_image_fname = argv[4];
     }
     else
     {
-        encInfo->stego_image_fname = "stego.bmp";
+        encInfo->stego_image_fname = (char *)carrier_default_stego_name(encInfo->carrier.format);
     }
 
     printf("\033[1;36m✅ Validation Passed: All inputs are verified!\033[0m\n");
     return e_success ;
 }
 
+/* Fill stego header fields from EncodeInfo */
+static void fill_stego_header(EncodeInfo *encInfo, StegoHeader *hdr)
+{
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->version = encInfo->header_version;
+    hdr->flags = encInfo->header_flags;
+    hdr->ecc_nsym = encInfo->ecc_nsym;
+    hdr->dedup_size = encInfo->dedup_size;
+    strcpy(hdr->extn_secret_file, encInfo->extn_secret_file);
+    hdr->size_secret_file = encInfo->size_secret_file;
+}
+
+/* Deduplicate the whole secret into encInfo->dedup_payload */
+static Status dedup_secret(EncodeInfo *encInfo)
+{
+    unsigned char *data = malloc(encInfo->size_secret_file + 1);
+    DedupStats stats;
+    Status ret = e_failure;
+
+    free(encInfo->dedup_payload);
+    encInfo->dedup_payload = NULL;
+    if (data && fseek(encInfo->fptr_secret, 0, SEEK_SET) == 0 &&
+        fread(data, 1, encInfo->size_secret_file, encInfo->fptr_secret) == (size_t)encInfo->size_secret_file &&
+        dedup_encode(data, encInfo->size_secret_file, &encInfo->dedup_payload, &encInfo->dedup_size, &stats) == e_success)
+    {
+        printf("\033[1;36m♻️  Dedup: %ld chunks, %ld distinct, %ld -> %ld bytes.\033[0m\n",
+               stats.chunks, stats.unique, encInfo->size_secret_file, encInfo->dedup_size);
+        ret = e_success;
+    }
+
+    free(data);
+    return ret;
+}
+
+/* Carrier bytes taken by the header and the payload after it */
+static long long stego_embedded_bytes(const EncodeInfo *encInfo)
+{
+    return stego_span_bytes(encInfo->header_length, encInfo->header_flags, encInfo->size_embedded);
+}
+
 /* Check image capacity
  * Input: EncodeInfo structure
  * Output: Returns e_success if image can hold secret data, else e_failure
  * Description:
  * Calculates image capacity and compares it with the total size needed
- * to store the magic string, file extension, file size, and secret data.
+ * to store the header (magic string, file extension, file size) and
+ * secret data, including ECC parity when --ecc is given.
  */
 Status check_capacity(EncodeInfo *encInfo)
 {
-    encInfo->image_capacity = get_image_size_for_bmp(encInfo->fptr_src_image);
+    const StegoOptions *opts = &encInfo->opts;
+    CarrierInfo *carrier = &encInfo->carrier;
+
+    if (probe_carrier(encInfo->fptr_src_image, opts, carrier) != e_success)
+        return e_failure;
+    printf("\033[1;36m🖥️  Image dimensions: %u x %u pixels.\033[0m\n", carrier->width, carrier->height);
+
+    // Version and flags follow from the options alone, as for the planner
     encInfo->size_secret_file = get_file_size(encInfo->fptr_secret);
+    encInfo->header_version = stego_job_version(opts);
+    encInfo->header_flags = stego_job_flags(opts);
+    encInfo->image_capacity = get_usable_capacity(carrier, opts);
+    encInfo->size_embedded = encInfo->size_secret_file;
+
+    if (opts->flags & OPT_DEDUP)
+    {
+        if (encInfo->header_version == STEGO_HEADER_V1)
+        {
+            printf("\033[1;36m❌ ERROR: --dedup needs the v2 header\033[0m\n");
+            return e_failure;
+        }
+        if (dedup_secret(encInfo) != e_success)
+            return e_failure;
+        encInfo->size_embedded = encInfo->dedup_size;
+    }
+
+    if (opts->flags & OPT_ECC)
+    {
+        if (encInfo->header_version == STEGO_HEADER_V1)
+        {
+            printf("\033[1;36m❌ ERROR: --ecc needs the v2 header\033[0m\n");
+            return e_failure;
+        }
+        encInfo->ecc_nsym = opts->ecc_nsym;
+        encInfo->size_embedded = ecc_encoded_size(encInfo->size_embedded, encInfo->ecc_nsym);
+    }
+
+    if ((opts->flags & OPT_ALPHA) && (encInfo->header_version == STEGO_HEADER_V1 || encInfo->image_capacity == 0))
+    {
+        printf("\033[1;36m❌ ERROR: --alpha needs a 32-bit carrier and the v2 header\033[0m\n");
+        return e_failure;
+    }
+
+    if ((opts->flags & OPT_MATRIX) && (encInfo->header_version == STEGO_HEADER_V1 || (opts->flags & OPT_ALPHA)))
+    {
+        printf("\033[1;36m❌ ERROR: --matrix needs the v2 header and LSB embedding\033[0m\n");
+        return e_failure;
+    }
+
+    // Header length depends on the version, flags and field values
+    StegoHeader hdr;
+    unsigned char buf[STEGO_HEADER_MAX];
+    fill_stego_header(encInfo, &hdr);
+    encInfo->header_length = build_stego_header(&hdr, buf);
+    if (encInfo->header_length == 0)
+    {
+        printf("\033[1;36m❌ ERROR: Secret file details do not fit in the header\033[0m\n");
+        return e_failure;
+    }
 
-    if (encInfo->image_capacity < ((strlen(MAGIC_STRING) + 4 + strlen(encInfo->extn_secret_file) + 4 + encInfo->size_secret_file) * 8) + 64)
+    if (encInfo->image_capacity < stego_embedded_bytes(encInfo))
     {
         printf("\033[1;36m❌ ERROR: Not enough space available!\033[0m\n");
         return e_failure;
@@ -164,49 +392,194 @@ Status check_capacity(EncodeInfo *encInfo)
     return e_success;
 }
 
-/* Perform encoding process
- * Input: EncodeInfo structure
- * Output: Returns e_success on successful encoding, else e_failure
+/* Start checkpointing
+ * Input: EncodeInfo, stego positioned at the payload
+ * Output: Returns e_success or e_failure
  * Description:
- * Opens files, checks capacity, and performs encoding steps:
- * copying BMP header, embedding magic string, file details, and secret data
- * into the output (stego) image.
+ * The job id covers both inputs and the embedded header, so only
+ * a record of the very same job is trusted. With --resume the
+ * verified payload prefix is skipped in the source image too.
  */
-Status do_encoding(EncodeInfo *encInfo)
+static Status start_encode_checkpoint(EncodeInfo *encInfo)
 {
-    // check if all required files are opened successfully 
-    if (open_files(encInfo) != e_success)
+    StegoHeader hdr;
+    unsigned char buf[STEGO_HEADER_MAX];
+    long span = stego_payload_span(encInfo->header_flags);
+
+    fill_stego_header(encInfo, &hdr);
+    uint len = build_stego_header(&hdr, buf);
+
+    unsigned long long id = checkpoint_hash(0, "e", 1);
+    id = checkpoint_hash_file(id, encInfo->fptr_src_image);
+    id = checkpoint_hash_file(id, encInfo->fptr_secret);
+    id = checkpoint_hash(id, buf, len);
+    id = checkpoint_hash(id, &encInfo->carrier.pixel_offset, sizeof(encInfo->carrier.pixel_offset));
+
+    if (checkpoint_resume(&encInfo->ckpt, id, encInfo->fptr_stego_image, encInfo->opts.flags & OPT_RESUME, span) != e_success)
+        return e_failure;
+    if (fseek(encInfo->fptr_src_image, encInfo->ckpt.payload_done * span, SEEK_CUR) != 0)
         return e_failure;
+    return e_success;
+}
 
+/* --metrics: measure the stream from the first pixel byte on */
+static Status start_metrics(EncodeInfo *encInfo)
+{
+    if (!(encInfo->opts.flags & OPT_METRICS))
+        return e_success;
+
+    MetricsAccumulator *acc = malloc(sizeof(*acc));
+    encInfo->metrics_carrier = malloc(STEGO_CHUNK_SIZE * STEGO_MAX_SPAN);
+    if (acc == NULL || encInfo->metrics_carrier == NULL || metrics_init(acc, &encInfo->carrier, NULL) != e_success)
+    {
+        free(acc);
+        return e_failure;
+    }
+    encInfo->metrics = acc;
+    return e_success;
+}
+
+/* Release the --metrics state */
+static void free_metrics(EncodeInfo *encInfo)
+{
+    if (encInfo->metrics)
+        metrics_free(encInfo->metrics);
+    free(encInfo->metrics);
+    free(encInfo->metrics_carrier);
+    encInfo->metrics = NULL;
+    encInfo->metrics_carrier = NULL;
+}
+
+/* Copy the rest of the image (unless a clone already holds it),
+ * measuring it as unchanged pixels */
+static Status copy_remaining_measured(EncodeInfo *encInfo, int write)
+{
+    unsigned char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), encInfo->fptr_src_image)) > 0)
+    {
+        if (write && fwrite(buffer, 1, n, encInfo->fptr_stego_image) != n)
+            return e_failure;
+        metrics_feed(encInfo->metrics, buffer, buffer, n);
+    }
+    return ferror(encInfo->fptr_src_image) ? e_failure : e_success;
+}
+
+/* Plan the I/O once the header and payload sizes are known */
+static void plan_encode_io(EncodeInfo *encInfo)
+{
+    IoPlan *plan = &encInfo->io_plan;
+    struct stat st;
+
+    plan->decode = 0;
+    plan->carrier_size = fstat(fileno(encInfo->fptr_src_image), &st) == 0 ? st.st_size : 0;
+    plan->touched = stego_embedded_bytes(encInfo);
+    plan->ecc = (encInfo->header_flags & (STEGO_FLAG_ECC | STEGO_FLAG_DEDUP)) != 0;
+    io_plan_probe(plan, fileno(encInfo->fptr_src_image), fileno(encInfo->fptr_stego_image));
+    io_plan_choose(plan, encInfo->opts.flags);
+
+    // Filesystems without O_DIRECT keep to buffered I/O
+    if (plan->strategy == e_io_direct &&
+        direct_open(&encInfo->direct, encInfo->fptr_src_image, encInfo->fptr_stego_image) != e_success)
+    {
+        plan->strategy = e_io_stdio;
+        plan->reason = "--direct refused by the filesystem, buffered I/O instead";
+    }
+
+    // The flag follows the plan, so --direct or a refused --direct
+    // never leaves a --pipeline request to take another path
+    if (plan->strategy == e_io_pipeline)
+        encInfo->opts.flags |= OPT_PIPELINE;
+    else
+        encInfo->opts.flags &= ~OPT_PIPELINE;
+    if (encInfo->opts.flags & OPT_EXPLAIN)
+        io_plan_explain(plan);
+}
+
+/* Clone-and-patch: the kernel puts the whole carrier into the
+ * output, the header and payload steps then overwrite their bytes */
+static Status clone_carrier(EncodeInfo *encInfo)
+{
+    int reflinked;
+    if (fflush(encInfo->fptr_stego_image) != 0 ||
+        io_clone_file(fileno(encInfo->fptr_src_image), fileno(encInfo->fptr_stego_image),
+                      encInfo->io_plan.carrier_size, &reflinked) != e_success)
+        return e_failure;
+
+    if (encInfo->opts.flags & OPT_EXPLAIN)
+        printf("   carrier %s\n", reflinked ? "cloned (extents shared)" : "copied with copy_file_range");
+    if (fseek(encInfo->fptr_src_image, encInfo->carrier.pixel_offset, SEEK_SET) != 0 ||
+        fseek(encInfo->fptr_stego_image, encInfo->carrier.pixel_offset, SEEK_SET) != 0)
+        return e_failure;
+    return e_success;
+}
+
+/* Lay down the carrier header, or the whole carrier when cloning */
+static Status write_carrier_base(EncodeInfo *encInfo)
+{
+    if (encInfo->io_plan.strategy == e_io_clone)
+    {
+        if (clone_carrier(encInfo) == e_success)
+            return e_success;
+
+        // Refused after all (e.g. a cross-device copy on an old kernel)
+        encInfo->io_plan.strategy = e_io_stdio;
+        if (encInfo->opts.flags & OPT_EXPLAIN)
+            printf("   kernel copy refused, falling back to stdio\n");
+        if (fseek(encInfo->fptr_stego_image, 0, SEEK_SET) != 0)
+            return e_failure;
+    }
+    return copy_carrier_header(encInfo->fptr_src_image, encInfo->fptr_stego_image, &encInfo->carrier);
+}
+
+/* Copy the image bytes after the payload */
+static Status copy_remaining(EncodeInfo *encInfo)
+{
+    // The direct stream has already copied the rest
+    if (encInfo->io_plan.strategy == e_io_direct)
+        return e_success;
+    int cloned = encInfo->io_plan.strategy == e_io_clone;
+    if (encInfo->metrics)
+        return copy_remaining_measured(encInfo, !cloned);
+    if (cloned)
+        return e_success;
+    return copy_remaining_img_data(encInfo->fptr_src_image, encInfo->fptr_stego_image);
+}
+
+/* Encoding steps once the files are open */
+static Status run_encoding_steps(EncodeInfo *encInfo)
+{
     // Check if image has enough capacity to hold secret data
     if (check_capacity(encInfo) != e_success)
         return e_failure;
 
-    // Copy BMP header
-    printf("\033[1;36m📄 Header copied successfully — canvas ready for steganography.\033[0m\n");    
-    if (copy_bmp_header(encInfo->fptr_src_image, encInfo->fptr_stego_image) != e_success)
+    if (start_metrics(encInfo) != e_success)
         return e_failure;
 
-    // Encode magic string
-    printf("\033[1;36m✨ Embedding magic signature to mark presence of hidden data.\033[0m\n");   
-    if (encode_magic_string(MAGIC_STRING, encInfo) != e_success)
-        return e_failure;
+    // Pick stdio, pipeline or clone-and-patch for this job
+    plan_encode_io(encInfo);
 
-    // Encode secret file extension size
-    printf("\033[1;36m🗂️  Storing secret file extension and size metadata.\033[0m\n");    
-    if (encode_secret_file_extn_size(strlen(encInfo->extn_secret_file), encInfo) != e_success)
+    // Copy the carrier's format header (BMP, PPM, PAM; none for raw)
+    printf("\033[1;36m📄 Header copied successfully — canvas ready for steganography.\033[0m\n");    
+    if (write_carrier_base(encInfo) != e_success)
         return e_failure;
 
-    // Encode secret file extension
-    printf("\033[1;36m📑 Writing secret file extension (.txt / .pdf / custom).\033[0m\n");
-    if (encode_secret_file_extn(encInfo->extn_secret_file, encInfo) != e_success)
+    // Encode magic string, secret file extension and size as one header
+    printf("\033[1;36m✨ Embedding magic signature, secret file extension and size (header v%u).\033[0m\n", encInfo->header_version);
+    if (encode_stego_header(encInfo) != e_success)
         return e_failure;
 
-    // Encode secret file size
-    printf("\033[1;36m📦 Capturing and recording exact secret file size.\033[0m\n");
-    if (encode_secret_file_size(encInfo->size_secret_file, encInfo) != e_success)
+    // Pick up from the last verified checkpoint with --resume
+    if (start_encode_checkpoint(encInfo) != e_success)
         return e_failure;
 
+    // The carrier bytes of the skipped prefix are not at hand
+    if (encInfo->metrics && encInfo->ckpt.payload_done > 0)
+    {
+        printf("\033[1;36mℹ️  Resumed job — --metrics skipped, run -m on the finished image.\033[0m\n");
+        free_metrics(encInfo);
+    }
+
     // Encode secret file data
     printf("\033[1;36m🔒 Encoding secret data into pixel bytes, bit by bit.\033[0m\n");
     if (encode_secret_file_data(encInfo) != e_success)
@@ -214,9 +587,99 @@ Status do_encoding(EncodeInfo *encInfo)
 
     // Copy remaining image data
     printf("\033[1;36m📤 Appending untouched image bytes to maintain visual integrity.\033[0m\n");
-    if (copy_remaining_img_data(encInfo->fptr_src_image, encInfo->fptr_stego_image) != e_success)
+    if (copy_remaining(encInfo) != e_success)
+        return e_failure;
+
+    if (encInfo->metrics)
+    {
+        MetricsResult result;
+        metrics_result(encInfo->metrics, 1, &result);
+        metrics_print(encInfo->stego_image_fname, &result);
+    }
+    return e_success;
+}
+
+/* Serve from --cache
+ * Input: EncodeInfo structure, nothing opened yet
+ * Output: Returns e_success when the stego image was served
+ * Description:
+ * The key covers the carrier and secret files and every switch
+ * that shapes the output bytes; --pipeline, --resume, --metrics and
+ * --explain only change how the same bytes are made. Jobs on
+ * caller-opened streams (daemon) are not cached.
+ */
+static Status serve_cached_encoding(EncodeInfo *encInfo)
+{
+    char params[256];
+    CacheServe how;
+
+    memset(&encInfo->cache_key, 0, sizeof(encInfo->cache_key));
+    if (!(encInfo->opts.flags & OPT_CACHE) || encInfo->fptr_src_image || encInfo->fptr_stego_image)
+        return e_failure;
+
+    const StegoOptions *o = &encInfo->opts;
+    uint shaping = o->flags & ~(OPT_PIPELINE | OPT_RESUME | OPT_METRICS | OPT_EXPLAIN | OPT_CACHE);
+    int len = snprintf(params, sizeof(params), "%x/%d/%u/%u/%u/%u/%u/%d/%s", shaping, o->ecc_nsym, o->matrix_k,
+                       o->raw_width, o->raw_height, o->raw_channels, o->raw_stride, encInfo->carrier.format,
+                       encInfo->extn_secret_file);
+
+    if (result_cache_key(encInfo->src_image_fname, encInfo->secret_fname, params, len, &encInfo->cache_key) != e_success ||
+        result_cache_serve(o->cache_dir, &encInfo->cache_key, encInfo->stego_image_fname, &how) != e_success)
         return e_failure;
 
+    printf("\033[1;36m⚡ Cache hit — stego image served from %s by %s.\033[0m\n", o->cache_dir, result_cache_serve_name(how));
+    if (o->flags & OPT_METRICS)
+        printf("\033[1;36mℹ️  Cached job — --metrics skipped, run -m on the finished image.\033[0m\n");
+    return e_success;
+}
+
+/* Add the finished stego image to --cache */
+static void store_cached_encoding(EncodeInfo *encInfo)
+{
+    long long max = encInfo->opts.cache_max > 0 ? encInfo->opts.cache_max : RESULT_CACHE_DEFAULT_MAX;
+
+    if (encInfo->cache_key.carrier_size == 0)
+        return;
+    if (result_cache_store(encInfo->opts.cache_dir, &encInfo->cache_key, encInfo->stego_image_fname, max) != e_success)
+        printf("\033[1;36mℹ️  Stego image not cached (cache directory unusable or image above --cache-max).\033[0m\n");
+}
+
+/* Perform encoding process
+ * Input: EncodeInfo structure
+ * Output: Returns e_success on successful encoding, else e_failure
+ * Description:
+ * Opens files, checks capacity, and performs encoding steps:
+ * copying the carrier header, embedding the header (magic string, file details)
+ * and secret data into the output (stego) image. The stego image
+ * is written as "<name>.part" and renamed into place when complete.
+ * With --cache an identical earlier job is served instead.
+ */
+Status do_encoding(EncodeInfo *encInfo)
+{
+    // An identical finished job is served without encoding
+    if (serve_cached_encoding(encInfo) == e_success)
+    {
+        printf("\033[1;36m🚀 Encoding process completed — your mission is accomplished!\033[0m\n");
+        return e_success;
+    }
+
+    // check if all required files are opened successfully, then
+    // run the steps and move the finished stego image into place
+    Status ret = e_success;
+    if (open_files(encInfo) != e_success || run_encoding_steps(encInfo) != e_success ||
+        checkpoint_commit(&encInfo->ckpt, encInfo->fptr_stego_image) != e_success)
+    {
+        checkpoint_abort(&encInfo->ckpt);
+        ret = e_failure;
+    }
+    free_metrics(encInfo);
+    direct_close(&encInfo->direct);
+    free(encInfo->dedup_payload);
+    encInfo->dedup_payload = NULL;
+    if (ret != e_success)
+        return e_failure;
+
+    store_cached_encoding(encInfo);
     printf("\033[1;36m🏆 Steganography successful — hidden data embedded securely.\033[0m\n");
 
     printf("\033[1;36m🚀 Encoding process completed — your mission is accomplished!\033[0m\n");
@@ -308,6 +771,30 @@ Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image)
     return e_success ;
 }
 
+/* Encode stego header
+ * Input: EncodeInfo structure (extension, size, header version set)
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Serialises the header in memory and embeds it in one pass. The
+ * compact (v2) header uses varint lengths and a CRC-8, so the
+ * decoder can fetch and validate it with a single read. With
+ * --legacy-header the v1 layout is written instead, with --ecc
+ * the header is one Reed-Solomon codeword.
+ */
+Status encode_stego_header(EncodeInfo *encInfo)
+{
+    StegoHeader hdr;
+    unsigned char buf[STEGO_HEADER_MAX];
+
+    fill_stego_header(encInfo, &hdr);
+    uint len = build_stego_header(&hdr, buf);
+    if (len == 0)
+        return e_failure;
+
+    // LSB or alpha bytes, like the payload after it
+    return encode_buffer_to_image(buf, len, encInfo);
+}
+
 /* Encode magic string
  * Input: Magic string and EncodeInfo structure
  * Output: Returns e_success after encoding, else e_failure
@@ -396,43 +883,286 @@ Status encode_secret_file_size(long file_size, EncodeInfo *encInfo)
  * Input: EncodeInfo structure
  * Output: Returns e_success or e_failure
  * Description:
- * Reads each byte from the secret file, encodes it into the LSBs
- * of 8 bytes from the source image, and writes to the stego image.
+ * Reads the secret file a chunk at a time, encodes each byte into
+ * the LSBs of 8 bytes from the source image (or one alpha byte with
+ * --alpha), and writes the chunk
+ * to the stego image. With --pipeline the reads, embedding and
+ * writes run in overlapping stages instead.
  */
 Status encode_secret_file_data(EncodeInfo *encInfo)
 {
     // Reset secret file pointer to beginning
     fseek(encInfo->fptr_secret, 0, SEEK_SET);
-    
-    // Buffer to hold 8 bytes from image
-    unsigned char buffer[8];
 
-    // Holds one byte from secret file
-    char data_byte;
-    
-    // Loop through each byte of the secret file
-    for(long i = 0; i < encInfo->size_secret_file; i++)
+    if (encInfo->header_flags & STEGO_FLAG_ECC)
+        return encode_secret_file_data_ecc(encInfo);
+
+    if (encInfo->header_flags & STEGO_FLAG_DEDUP)
+        return encode_payload_buffer(encInfo->dedup_payload, encInfo->dedup_size, encInfo);
+
+    // Skip what a resumed job has already embedded
+    long start = encInfo->ckpt.payload_done;
+    if (fseek(encInfo->fptr_secret, start, SEEK_SET) != 0)
+        return e_failure;
+
+    if (encInfo->io_plan.strategy == e_io_direct)
+        return encode_payload_direct(NULL, encInfo->size_secret_file, encInfo);
+
+    if (encInfo->io_plan.strategy == e_io_pipeline)
+        return encode_secret_file_data_pipelined(encInfo);
+
+    // Chunk of secret bytes and the image bytes that hold them
+    long span = stego_payload_span(encInfo->header_flags);
+    unsigned char *data = malloc(STEGO_CHUNK_SIZE);
+    unsigned char *buffer = malloc(STEGO_CHUNK_SIZE * span);
+    Status ret = (data && buffer) ? e_success : e_failure;
+
+    // Loop through the secret file chunk by chunk
+    for (long done = start; ret == e_success && done < encInfo->size_secret_file; )
     {
-        // Read one byte from secret file
-        if(fread(&data_byte, 1, 1, encInfo->fptr_secret) != 1)
-            return e_failure;
-        
-        // Read 8 bytes from source image
-        if(fread(buffer, 1, 8, encInfo->fptr_src_image) != 8)
-            return e_failure;
-        
-        // Encode the secret byte into LSBs of the image buffer
-        if (encode_byte_to_lsb(data_byte, (char *)buffer) != e_success)
-            return e_failure;
-        
-        // Write to stego image
-        if(fwrite(buffer, 1, 8, encInfo->fptr_stego_image) != 8)
-            return e_failure;
+        long n = encInfo->size_secret_file - done;
+        if (n > STEGO_CHUNK_SIZE)
+            n = STEGO_CHUNK_SIZE;
+
+        // Read secret bytes and span image bytes per secret byte,
+        // encode them into the LSBs (or alpha) and write to stego image
+        if (fread(data, 1, n, encInfo->fptr_secret) != (size_t)n ||
+            fread(buffer, 1, n * span, encInfo->fptr_src_image) != (size_t)(n * span) ||
+            encode_payload_chunk(encInfo, data, n, buffer) != e_success ||
+            fwrite(buffer, 1, n * span, encInfo->fptr_stego_image) != (size_t)(n * span) ||
+            checkpoint_progress(&encInfo->ckpt, encInfo->fptr_stego_image, buffer, n * span, done + n) != e_success)
+            ret = e_failure;
+        done += n;
     }
-    
+
+    free(data);
+    free(buffer);
+    return ret;
+}
+
+/* Encode secret file data with ECC
+ * Input: EncodeInfo structure
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Reads the whole secret (or takes the --dedup container), adds
+ * interleaved Reed-Solomon parity (ecc_nsym bytes per codeword)
+ * and embeds the result.
+ */
+Status encode_secret_file_data_ecc(EncodeInfo *encInfo)
+{
+    // With --dedup the container is protected instead of the secret
+    long size = encInfo->dedup_payload ? encInfo->dedup_size : encInfo->size_secret_file;
+    unsigned char *data = encInfo->dedup_payload ? NULL : malloc(size + 1);
+    const unsigned char *content = encInfo->dedup_payload ? encInfo->dedup_payload : data;
+    unsigned char *stored = malloc(encInfo->size_embedded + 1);
+    Status ret = e_failure;
+
+    if (content && stored &&
+        (encInfo->dedup_payload || fread(data, 1, size, encInfo->fptr_secret) == (size_t)size) &&
+        rs_encode_interleaved(content, size, encInfo->ecc_nsym, stored) == e_success)
+    {
+        printf("\033[1;36m🛡️  Reed-Solomon parity added: %ld -> %ld bytes.\033[0m\n", size, encInfo->size_embedded);
+        ret = encode_payload_buffer(stored, encInfo->size_embedded, encInfo);
+    }
+
+    free(data);
+    free(stored);
+    return ret;
+}
+
+/* Embed a chunk in the layout given by flags (header or payload) */
+static Status embed_chunk(const EncodeInfo *encInfo, uint flags, const unsigned char *data, long size, unsigned char *image_buffer)
+{
+    long span = stego_payload_span(flags);
+    Status ret;
+
+    // --metrics compares the chunk before and after embedding
+    if (encInfo->metrics)
+        memcpy(encInfo->metrics_carrier, image_buffer, size * span);
+
+    if (flags & STEGO_FLAG_MATRIX)
+        ret = encode_chunk_matrix(data, size, image_buffer, STEGO_MATRIX_K(flags));
+    else if (flags & STEGO_FLAG_ALPHA)
+        ret = encode_chunk_to_alpha(data, size, image_buffer);
+    else
+        ret = encode_chunk_to_lsb(data, size, image_buffer);
+
+    if (encInfo->metrics)
+        metrics_feed(encInfo->metrics, encInfo->metrics_carrier, image_buffer, size * span);
+    return ret;
+}
+
+/* Encode buffer to image
+ * Input: Bytes to hide, their count, EncodeInfo structure
+ * Output: Returns e_success or e_failure
+ * Description: Embeds an in-memory buffer in the header layout
+ * chunk by chunk, reading and writing 8 image bytes (4 with
+ * --alpha) per data byte; matrix embedding is for the payload only.
+ */
+Status encode_buffer_to_image(const unsigned char *data, long size, EncodeInfo *encInfo)
+{
+    uint layout = stego_header_layout(encInfo->header_flags);
+    long span = stego_payload_span(layout);
+    unsigned char *buffer = malloc(STEGO_CHUNK_SIZE * span);
+    Status ret = buffer ? e_success : e_failure;
+
+    for (long done = 0; ret == e_success && done < size; )
+    {
+        long n = size - done < STEGO_CHUNK_SIZE ? size - done : STEGO_CHUNK_SIZE;
+        if (fread(buffer, 1, n * span, encInfo->fptr_src_image) != (size_t)(n * span) ||
+            embed_chunk(encInfo, layout, data + done, n, buffer) != e_success ||
+            fwrite(buffer, 1, n * span, encInfo->fptr_stego_image) != (size_t)(n * span))
+            ret = e_failure;
+        done += n;
+    }
+
+    free(buffer);
+    return ret;
+}
+
+/* Encode payload with O_DIRECT
+ * Input: Payload bytes (NULL: read the secret file), their count,
+ *        EncodeInfo structure with the direct stream open
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Chunks are embedded in place in the aligned window, then the rest
+ * of the carrier is streamed through unchanged (and counted for
+ * --metrics). Nothing is cached by the kernel on the way.
+ */
+Status encode_payload_direct(const unsigned char *data, long size, EncodeInfo *encInfo)
+{
+    DirectStream *ds = &encInfo->direct;
+    long span = stego_payload_span(encInfo->header_flags), avail;
+    unsigned char *chunk = data ? NULL : malloc(STEGO_CHUNK_SIZE);
+    unsigned char *image;
+    Status ret = e_failure;
+
+    if ((data || chunk) && direct_start(ds, encInfo->fptr_src_image, encInfo->fptr_stego_image) == e_success)
+        ret = e_success;
+
+    for (long done = 0; ret == e_success && done < size; )
+    {
+        long n = size - done < STEGO_CHUNK_SIZE ? size - done : STEGO_CHUNK_SIZE;
+        if (direct_window(ds, n * span, &image, &avail) != e_success || avail < n * span ||
+            (chunk && fread(chunk, 1, n, encInfo->fptr_secret) != (size_t)n) ||
+            encode_payload_chunk(encInfo, chunk ? chunk : data + done, n, image) != e_success)
+            ret = e_failure;
+        ds->pos += n * span;
+        done += n;
+    }
+
+    // Unchanged bytes still count towards --metrics
+    while (ret == e_success && encInfo->metrics)
+    {
+        if (direct_window(ds, 1, &image, &avail) != e_success)
+            ret = e_failure;
+        else if (avail == 0)
+            break;
+        else
+        {
+            metrics_feed(encInfo->metrics, image, image, avail);
+            ds->pos += avail;
+        }
+    }
+
+    if (ret == e_success)
+        ret = direct_finish(ds, encInfo->fptr_src_image, encInfo->fptr_stego_image);
+
+    free(chunk);
+    return ret;
+}
+
+/* Encode payload buffer
+ * Input: Embedded payload bytes, their count, EncodeInfo structure
+ * Output: Returns e_success or e_failure
+ * Description: Like encode_buffer_to_image, but starts after the
+ * part a resumed job has already written and records checkpoints.
+ */
+Status encode_payload_buffer(const unsigned char *data, long size, EncodeInfo *encInfo)
+{
+    if (encInfo->io_plan.strategy == e_io_direct)
+        return encode_payload_direct(data, size, encInfo);
+
+    long span = stego_payload_span(encInfo->header_flags);
+    unsigned char *buffer = malloc(STEGO_CHUNK_SIZE * span);
+    Status ret = buffer ? e_success : e_failure;
+
+    for (long done = encInfo->ckpt.payload_done; ret == e_success && done < size; )
+    {
+        long n = size - done < STEGO_CHUNK_SIZE ? size - done : STEGO_CHUNK_SIZE;
+        if (fread(buffer, 1, n * span, encInfo->fptr_src_image) != (size_t)(n * span) ||
+            encode_payload_chunk(encInfo, data + done, n, buffer) != e_success ||
+            fwrite(buffer, 1, n * span, encInfo->fptr_stego_image) != (size_t)(n * span) ||
+            checkpoint_progress(&encInfo->ckpt, encInfo->fptr_stego_image, buffer, n * span, done + n) != e_success)
+            ret = e_failure;
+        done += n;
+    }
+
+    free(buffer);
+    return ret;
+}
+
+/* Encode chunk to LSBs
+ * Input: Data bytes, their count, image buffer of size * 8 bytes
+ * Output: Returns e_success
+ * Description: Encodes each data byte into 8 consecutive image bytes.
+ */
+Status encode_chunk_to_lsb(const unsigned char *data, long size, unsigned char *image_buffer)
+{
+    for (long i = 0; i < size; i++)
+        encode_byte_to_lsb(data[i], (char *)image_buffer + i * 8);
+
     return e_success;
 }
 
+/* Encode chunk to alpha bytes
+ * Input: Data bytes, their count, image buffer of size * 4 bytes
+ * Output: Returns e_success
+ * Description: Stores data byte i whole in byte 4 * i + 3 (the alpha
+ * of a BGRA / RGBA pixel); colour bytes are kept. With SSE2, 16 data
+ * bytes are widened to the top byte of 16 32-bit lanes and merged
+ * into 64 image bytes per step.
+ */
+Status encode_chunk_to_alpha(const unsigned char *data, long size, unsigned char *image_buffer)
+{
+    long i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i colour = _mm_set1_epi32(0x00FFFFFF);
+    for (; i + 16 <= size; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i lo = _mm_unpacklo_epi8(zero, v);
+        __m128i hi = _mm_unpackhi_epi8(zero, v);
+        __m128i alpha[4] = {
+            _mm_unpacklo_epi16(zero, lo), _mm_unpackhi_epi16(zero, lo),
+            _mm_unpacklo_epi16(zero, hi), _mm_unpackhi_epi16(zero, hi)
+        };
+
+        for (int k = 0; k < 4; k++)
+        {
+            __m128i *p = (__m128i *)(image_buffer + (i + 4 * k) * STEGO_ALPHA_SPAN);
+            __m128i pixels = _mm_and_si128(_mm_loadu_si128(p), colour);
+            _mm_storeu_si128(p, _mm_or_si128(pixels, alpha[k]));
+        }
+    }
+#endif
+    for (; i < size; i++)
+        image_buffer[i * STEGO_ALPHA_SPAN + 3] = data[i];
+
+    return e_success;
+}
+
+/* Encode payload chunk
+ * Input: EncodeInfo (header flags set), data, count, image buffer
+ * Output: Returns e_success or e_failure
+ * Description: Picks the LSB, alpha or matrix kernel for this stego image.
+ */
+Status encode_payload_chunk(const EncodeInfo *encInfo, const unsigned char *data, long size, unsigned char *image_buffer)
+{
+    return embed_chunk(encInfo, encInfo->header_flags, data, size, image_buffer);
+}
+
 /* Copy remaining image data
  * Input: Source and destination image file pointers
  * Output: Returns e_success or e_failure
@@ -2,6 +2,13 @@
 #define ENCODE_H
 
 #include "types.h" // Contains user defined types
+#include "options.h" // Optional switches
+#include "carrier.h" // Carrier format header layer
+#include "checkpoint.h" // Resumable output
+#include "io_strategy.h" // I/O planner
+#include "metrics.h" // Carrier vs stego distortion
+#include "direct_io.h" // O_DIRECT streaming
+#include "result_cache.h" // --cache key
 
 /* 
  * Structure to store information required for
@@ -12,16 +19,17 @@
 
 #define MAX_SECRET_BUF_SIZE 1
 #define MAX_IMAGE_BUF_SIZE (MAX_SECRET_BUF_SIZE * 8)
-#define MAX_FILE_SUFFIX 4
+#define MAX_FILE_SUFFIX 50
 
 typedef struct _EncodeInfo
 {
     /* Source Image info */
     char *src_image_fname;
     FILE *fptr_src_image;
-    uint image_capacity;
+    long long image_capacity;
     uint bits_per_pixel;
     char image_data[MAX_IMAGE_BUF_SIZE];
+    CarrierInfo carrier;
 
     /* Secret File Info */
     char *secret_fname;
@@ -30,10 +38,40 @@ typedef struct _EncodeInfo
     char secret_data[MAX_SECRET_BUF_SIZE];
     long size_secret_file;
 
+    /* Embedded header info */
+    uint header_version;
+    uint header_flags;
+    uint header_length;
+    uint ecc_nsym;
+
+    /* Secret bytes as embedded (after dedup and ECC parity) */
+    long size_embedded;
+
+    /* --dedup: chunk-deduplicated container embedded instead of the secret */
+    unsigned char *dedup_payload;
+    long dedup_size;
+
     /* Stego Image Info */
     char *stego_image_fname;
     FILE *fptr_stego_image;
 
+    /* Optional switches */
+    StegoOptions opts;
+
+    /* .part output and checkpoints (inactive for caller-opened streams) */
+    Checkpoint ckpt;
+
+    /* How the bytes are moved, chosen once the sizes are known */
+    IoPlan io_plan;
+    DirectStream direct;        /* Open while the plan is direct */
+
+    /* --cache: key of this job, carrier_size 0 when it is not cached */
+    ResultCacheKey cache_key;
+
+    /* --metrics: distortion measured on the chunks as they are embedded */
+    MetricsAccumulator *metrics;
+    unsigned char *metrics_carrier;     /* Carrier bytes of the current chunk */
+
 } EncodeInfo;
 
 
@@ -54,15 +92,27 @@ Status open_files(EncodeInfo *encInfo);
 /* check capacity */
 Status check_capacity(EncodeInfo *encInfo);
 
+/* Read width, height and bits per pixel from BMP header */
+Status read_bmp_geometry(FILE *fptr_image, uint *width, uint *height, uint *bits_per_pixel);
+
 /* Get image size */
 uint get_image_size_for_bmp(FILE *fptr_image);
 
+/* Carrier bytes an encode with opts may use, 0 if opts cannot use it */
+long long get_usable_capacity(const CarrierInfo *carrier, const StegoOptions *opts);
+
+/* Carrier bytes an encode with opts needs for a secret, 0 if impossible */
+long long get_required_capacity(const char *extn, long size_secret_file, const StegoOptions *opts);
+
 /* Get file size */
-uint get_file_size(FILE *fptr);
+long get_file_size(FILE *fptr);
 
 /* Copy bmp image header */
 Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image);
 
+/* Encode the whole embedded header (magic, extension, size) at once */
+Status encode_stego_header(EncodeInfo *encInfo);
+
 /* Store Magic String */
 Status encode_magic_string(const char *magic_string, EncodeInfo *encInfo);
 
@@ -77,9 +127,33 @@ Status encode_secret_file_size(long file_size, EncodeInfo *encInfo);
 /* Encode secret file data*/
 Status encode_secret_file_data(EncodeInfo *encInfo);
 
+/* Encode secret file data with Reed-Solomon parity */
+Status encode_secret_file_data_ecc(EncodeInfo *encInfo);
+
+/* Embed an in-memory buffer into the next size * 8 image bytes */
+Status encode_buffer_to_image(const unsigned char *data, long size, EncodeInfo *encInfo);
+
+/* Embed the payload buffer from the resume point, with checkpoints */
+Status encode_payload_buffer(const unsigned char *data, long size, EncodeInfo *encInfo);
+
+/* Embed the payload (from data, or the secret file if NULL) with O_DIRECT */
+Status encode_payload_direct(const unsigned char *data, long size, EncodeInfo *encInfo);
+
 /* Encode function, which does the real encoding */
 Status encode_data_to_image(const char *data, int size, FILE *fptr_src_image, FILE *fptr_stego_image);
 
+/* Encode a chunk of bytes into LSBs of size * 8 image bytes */
+Status encode_chunk_to_lsb(const unsigned char *data, long size, unsigned char *image_buffer);
+
+/* Store each data byte whole in the alpha byte of size 4-byte pixels */
+Status encode_chunk_to_alpha(const unsigned char *data, long size, unsigned char *image_buffer);
+
+/* Encode a chunk with the layout (LSB or alpha) of this stego image */
+Status encode_payload_chunk(const EncodeInfo *encInfo, const unsigned char *data, long size, unsigned char *image_buffer);
+
+/* Encode secret file data with overlapped read / embed / write stages */
+Status encode_secret_file_data_pipelined(EncodeInfo *encInfo);
+
 /* Encode a byte into LSB of image data array */
 Status encode_byte_to_lsb(int data, char *image_buffer);
 
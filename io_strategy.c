@@ -0,0 +1,166 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <linux/fs.h>
+#include "io_strategy.h"
+#include "options.h"
+#include "types.h"
+
+/* Filesystems that share extents on FICLONE */
+#define BTRFS_MAGIC 0x9123683E
+#define XFS_MAGIC 0x58465342
+
+/* Function Definitions */
+
+/* Name of a strategy */
+const char *io_strategy_name(IoStrategy strategy)
+{
+    switch (strategy)
+    {
+        case e_io_pipeline: return "pipeline";
+        case e_io_clone:    return "clone-and-patch";
+        case e_io_mmap:     return "mmap";
+        case e_io_direct:   return "direct";
+        default:            return "stdio";
+    }
+}
+
+/* Probe I/O plan
+ * Input: Plan (decode, carrier_size and touched are the caller's),
+ *        input descriptor, output descriptor or -1
+ * Output: None
+ * Description: Only cheap metadata calls; whether a reflink really
+ * works is found out when io_clone_file() tries it.
+ */
+void io_plan_probe(IoPlan *plan, int fd_in, int fd_out)
+{
+    struct stat st_in, st_out;
+    struct statfs fs;
+
+    plan->cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (plan->cores < 1)
+        plan->cores = 1;
+
+    plan->regular = fstat(fd_in, &st_in) == 0 && S_ISREG(st_in.st_mode);
+    plan->reflink = 0;
+    plan->copy_range = 0;
+    if (fd_out < 0)
+        return;
+
+    plan->regular = plan->regular && fstat(fd_out, &st_out) == 0 && S_ISREG(st_out.st_mode);
+    if (!plan->regular)
+        return;
+
+    // copy_file_range stays in the kernel between files of one filesystem
+    plan->copy_range = st_in.st_dev == st_out.st_dev;
+    plan->reflink = plan->copy_range && fstatfs(fd_out, &fs) == 0 &&
+                    ((unsigned long)fs.f_type == BTRFS_MAGIC || (unsigned long)fs.f_type == XFS_MAGIC);
+}
+
+/* Choose I/O strategy
+ * Input: Probed plan, option flags
+ * Output: None
+ * Description:
+ * --direct is honoured first, except for a resumed encode (its
+ * checkpoints need the payload on disk as it is embedded); the
+ * caller falls back to stdio when the filesystem refuses O_DIRECT.
+ * --pipeline is honoured next. An encode whose header and payload
+ * touch a small share of the carrier clones it and patches the
+ * touched bytes; a resumed job keeps its verified .part prefix and
+ * does not. Large payloads with cores to spare use the pipeline
+ * (not for ECC or dedup, which are one buffer), mid-sized decodes the mapping.
+ */
+void io_plan_choose(IoPlan *plan, uint flags)
+{
+    double ratio = plan->carrier_size > 0 ? (double)plan->touched / plan->carrier_size : 1.0;
+
+    if ((flags & OPT_DIRECT) && (plan->decode || !(flags & OPT_RESUME)))
+    {
+        plan->strategy = e_io_direct;
+        plan->reason = "requested with --direct, the page cache is bypassed";
+    }
+    else if (flags & OPT_PIPELINE)
+    {
+        plan->strategy = e_io_pipeline;
+        plan->reason = "requested with --pipeline";
+    }
+    else if (!plan->decode && plan->regular && !(flags & OPT_RESUME) &&
+             ((plan->reflink && ratio < IO_CLONE_RATIO_REFLINK) || (plan->copy_range && ratio < IO_CLONE_RATIO_COPY)))
+    {
+        plan->strategy = e_io_clone;
+        plan->reason = plan->reflink ? "the filesystem shares extents, only touched bytes are written"
+                                     : "most of the carrier is copied unchanged, the kernel copies it";
+    }
+    else if (!plan->ecc && plan->touched >= IO_PIPELINE_MIN && plan->cores >= 3)
+    {
+        plan->strategy = e_io_pipeline;
+        plan->reason = "large payload, reading, embedding and writing overlap on spare cores";
+    }
+    else if (plan->decode && !plan->ecc && plan->regular && plan->touched >= IO_MMAP_MIN)
+    {
+        plan->strategy = e_io_mmap;
+        plan->reason = "payload is extracted from the mapping without read copies";
+    }
+    else
+    {
+        plan->strategy = e_io_stdio;
+        if (plan->touched < IO_PIPELINE_MIN)
+            plan->reason = "payload below the pipeline threshold, buffered I/O is cheapest";
+        else if (plan->ecc)
+            plan->reason = "ECC and dedup payloads are processed as one buffer";
+        else
+            plan->reason = "too few cores for the pipeline threads";
+    }
+}
+
+/* Explain I/O plan
+ * Input: Chosen plan
+ * Output: None
+ * Description: Prints the inputs of the decision and the result.
+ */
+void io_plan_explain(const IoPlan *plan)
+{
+    double ratio = plan->carrier_size > 0 ? 100.0 * plan->touched / plan->carrier_size : 100.0;
+
+    printf("\033[1;36m🧭 I/O plan: %s — %s\033[0m\n", io_strategy_name(plan->strategy), plan->reason);
+    printf("   %s %lld bytes, header + payload touch %lld bytes (%.2f%%), %d cores\n",
+           plan->decode ? "stego image" : "carrier", plan->carrier_size, plan->touched, ratio, plan->cores);
+    if (plan->decode)
+        printf("   regular file: %s\n", plan->regular ? "yes" : "no");
+    else
+        printf("   regular files: %s, reflink: %s, copy_file_range: %s\n", plan->regular ? "yes" : "no",
+               plan->reflink ? "likely" : "no", plan->copy_range ? "yes" : "no");
+}
+
+/* Clone file
+ * Input: Source and destination descriptors, bytes to copy,
+ *        flag set when the extents were shared
+ * Output: Returns e_success or e_failure (caller copies instead)
+ * Description: FICLONE shares the extents of the whole file; where
+ * that is refused, copy_file_range copies inside the kernel.
+ */
+Status io_clone_file(int fd_in, int fd_out, long long size, int *reflinked)
+{
+    *reflinked = 0;
+    if (ioctl(fd_out, FICLONE, fd_in) == 0)
+    {
+        *reflinked = 1;
+        return e_success;
+    }
+
+    off64_t off_in = 0, off_out = 0;
+    while (off_in < size)
+    {
+        ssize_t n = copy_file_range(fd_in, &off_in, fd_out, &off_out, size - off_in, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return e_failure;
+    }
+    return e_success;
+}
@@ -0,0 +1,79 @@
+#ifndef IO_STRATEGY_H
+#define IO_STRATEGY_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * I/O planner: picks how an encode or decode moves its bytes from
+ * the carrier size, the share of it the header and payload touch,
+ * what the files and filesystem allow and the core count.
+ *
+ *   stdio     buffered read / embed / write, one thread
+ *   pipeline  the same in overlapped reader / transform / writer threads
+ *   clone     (encode) the carrier is cloned into the output by the
+ *             kernel (reflink or copy_file_range) and only the
+ *             touched pixel bytes are rewritten
+ *   mmap      (decode) payload chunks are extracted straight from a
+ *             read-only mapping of the stego image
+ *   direct    the carrier (and the stego output) are streamed with
+ *             O_DIRECT through an aligned window, bypassing the page
+ *             cache; only on request (--direct)
+ *
+ * --pipeline still forces the pipeline; --explain prints the plan.
+ */
+
+/* Pixel bytes worth the pipeline threads */
+#define IO_PIPELINE_MIN (64LL * 1024 * 1024)
+
+/* Payload bytes worth a mapping (decode) */
+#define IO_MMAP_MIN (1LL * 1024 * 1024)
+
+/* Largest touched share of the carrier for clone-and-patch:
+ * a reflink copies nothing, a kernel copy still copies every byte */
+#define IO_CLONE_RATIO_REFLINK 0.9
+#define IO_CLONE_RATIO_COPY 0.25
+
+typedef enum
+{
+    e_io_stdio,
+    e_io_pipeline,
+    e_io_clone,
+    e_io_mmap,
+    e_io_direct
+} IoStrategy;
+
+typedef struct _IoPlan
+{
+    IoStrategy strategy;
+    const char *reason;
+
+    /* Inputs */
+    int decode;
+    long long carrier_size;     /* Carrier (encode) or stego (decode) file bytes */
+    long long touched;          /* Pixel bytes holding header and payload */
+    int ecc;                    /* Payload is handled as one buffer (ECC, dedup) */
+    int cores;
+    int regular;                /* Input, and output if any, are regular files */
+    int reflink;                /* Output filesystem can share extents */
+    int copy_range;             /* Input and output on one filesystem */
+} IoPlan;
+
+
+/* I/O strategy function prototype */
+
+/* Fill the file, filesystem and core facts of a plan (fd_out -1 for none) */
+void io_plan_probe(IoPlan *plan, int fd_in, int fd_out);
+
+/* Choose the strategy from the plan inputs and the option flags */
+void io_plan_choose(IoPlan *plan, uint flags);
+
+/* Print the plan and why it was chosen (--explain) */
+void io_plan_explain(const IoPlan *plan);
+
+/* Name of a strategy */
+const char *io_strategy_name(IoStrategy strategy);
+
+/* Copy size bytes from fd_in to fd_out in the kernel: reflink, else copy_file_range */
+Status io_clone_file(int fd_in, int fd_out, long long size, int *reflinked);
+
+#endif
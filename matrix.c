@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "matrix.h"
+#include "types.h"
+
+/* Words of LSB bits for one block */
+#define MATRIX_WORDS ((MATRIX_BLOCK * MATRIX_MAX_SPAN + 63) / 64)
+
+/* Function Definitions */
+
+int matrix_k_supported(uint k)
+{
+    return k == 2 || k == 4;
+}
+
+uint matrix_span(uint k)
+{
+    return (8 / k) * ((1u << k) - 1);
+}
+
+/* Syndrome bit j covers the positions whose 1-based index has bit j set */
+static void matrix_masks(uint k, uint *masks)
+{
+    uint n = (1u << k) - 1;
+    for (uint j = 0; j < k; j++)
+    {
+        masks[j] = 0;
+        for (uint i = 0; i < n; i++)
+            if (((i + 1) >> j) & 1)
+                masks[j] |= 1u << i;
+    }
+}
+
+/* Pack the LSBs of n image bytes into a bit array, bit i = byte i */
+static void gather_lsbs(const unsigned char *image, long n, unsigned long long *bits)
+{
+    long i = 0;
+
+    memset(bits, 0, ((n + 63) / 64) * sizeof(*bits));
+#ifdef __SSE2__
+    // Shifting bit 0 into bit 7 of every byte lets movemask collect 16 at once
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_slli_epi16(_mm_loadu_si128((const __m128i *)(image + i)), 7);
+        bits[i / 64] |= (unsigned long long)(uint)_mm_movemask_epi8(v) << (i % 64);
+    }
+#endif
+    for (; i < n; i++)
+        bits[i / 64] |= (unsigned long long)(image[i] & 1) << (i % 64);
+}
+
+/* Syndrome of the n LSB bits starting at bit off */
+static inline uint group_syndrome(const unsigned long long *bits, long off, uint k, const uint *masks)
+{
+    uint n = (1u << k) - 1, shift = off % 64;
+    unsigned long long w = bits[off / 64] >> shift;
+    if (shift + n > 64)
+        w |= bits[off / 64 + 1] << (64 - shift);
+
+    uint group = w & ((1u << n) - 1), syndrome = 0;
+    for (uint j = 0; j < k; j++)
+        syndrome |= (uint)__builtin_parity(group & masks[j]) << j;
+    return syndrome;
+}
+
+/* Encode chunk by matrix embedding
+ * Input: Data bytes, their count, image buffer of size * span bytes, k
+ * Output: Returns e_success or e_failure for an unsupported k
+ * Description: Groups are taken from the most significant bits
+ * down; a group whose syndrome differs flips one LSB.
+ */
+Status encode_chunk_matrix(const unsigned char *data, long size, unsigned char *image_buffer, uint k)
+{
+    if (!matrix_k_supported(k))
+        return e_failure;
+
+    uint n = (1u << k) - 1, groups = 8 / k, span = matrix_span(k), masks[8];
+    unsigned long long bits[MATRIX_WORDS];
+    matrix_masks(k, masks);
+
+    for (long b = 0; b < size; b += MATRIX_BLOCK)
+    {
+        long count = size - b < MATRIX_BLOCK ? size - b : MATRIX_BLOCK;
+        unsigned char *block = image_buffer + b * span;
+        gather_lsbs(block, count * span, bits);
+
+        for (long i = 0; i < count; i++)
+            for (uint g = 0; g < groups; g++)
+            {
+                long off = i * span + g * n;
+                uint message = (data[b + i] >> (8 - k * (g + 1))) & ((1u << k) - 1);
+                uint flip = group_syndrome(bits, off, k, masks) ^ message;
+                if (flip)
+                    block[off + flip - 1] ^= 1;
+            }
+    }
+    return e_success;
+}
+
+/* Decode chunk by matrix embedding
+ * Input: Output buffer, byte count, image buffer of size * span bytes, k
+ * Output: Returns e_success or e_failure for an unsupported k
+ * Description: Each byte is its group syndromes, most significant first.
+ */
+Status decode_chunk_matrix(unsigned char *data, long size, const unsigned char *image_buffer, uint k)
+{
+    if (!matrix_k_supported(k))
+        return e_failure;
+
+    uint n = (1u << k) - 1, groups = 8 / k, span = matrix_span(k), masks[8];
+    unsigned long long bits[MATRIX_WORDS];
+    matrix_masks(k, masks);
+
+    for (long b = 0; b < size; b += MATRIX_BLOCK)
+    {
+        long count = size - b < MATRIX_BLOCK ? size - b : MATRIX_BLOCK;
+        gather_lsbs(image_buffer + b * span, count * span, bits);
+
+        for (long i = 0; i < count; i++)
+        {
+            uint byte = 0;
+            for (uint g = 0; g < groups; g++)
+                byte = (byte << k) | group_syndrome(bits, i * span + g * n, k, masks);
+            data[b + i] = byte;
+        }
+    }
+    return e_success;
+}
@@ -0,0 +1,49 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * Matrix embedding with (1, 2^k - 1, k) Hamming codes.
+ *
+ * Each k-bit group of a payload byte is carried by the LSBs of
+ * n = 2^k - 1 carrier bytes: the group is the syndrome of those
+ * LSBs (XOR of the 1-based positions holding a 1). Embedding flips
+ * at most one LSB per group, the one at position syndrome ^ group.
+ *
+ * k divides 8, so a payload byte always takes a whole number of
+ * carrier bytes (8 / k groups of n bytes) and the chunk, pipeline
+ * and checkpoint code keeps working per byte:
+ *
+ *   k = 2: 12 carrier bytes per byte, at most 4 changed (3 expected)
+ *   k = 4: 30 carrier bytes per byte, at most 2 changed (1.875 expected)
+ *
+ * against 8 bytes with 4 expected changes for plain LSB embedding.
+ *
+ * Syndromes are bit-sliced: the LSBs of a block are gathered into
+ * a bit array (16 per SSE2 movemask), then syndrome bit j of a
+ * group is the parity of its LSB bits under a fixed mask.
+ */
+
+#define MATRIX_DEFAULT_K 4
+#define MATRIX_MAX_SPAN 30
+
+/* Payload bytes per LSB gather */
+#define MATRIX_BLOCK 64
+
+
+/* Matrix embedding function prototype */
+
+/* Non-zero for a supported k (2 or 4) */
+int matrix_k_supported(uint k);
+
+/* Carrier bytes per payload byte for k */
+uint matrix_span(uint k);
+
+/* Embed size bytes into size * matrix_span(k) image bytes */
+Status encode_chunk_matrix(const unsigned char *data, long size, unsigned char *image_buffer, uint k);
+
+/* Extract size bytes from size * matrix_span(k) image bytes */
+Status decode_chunk_matrix(unsigned char *data, long size, const unsigned char *image_buffer, uint k);
+
+#endif
@@ -0,0 +1,474 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "metrics.h"
+#include "options.h"
+#include "types.h"
+
+/* SSIM stabilisers for 8-bit samples: (0.01 * 255)^2, (0.03 * 255)^2 */
+#define SSIM_C1 6.5025
+#define SSIM_C2 58.5225
+
+/* Sums per window and channel */
+#define WINDOW_SUMS 5
+
+/* Shared state of one -m comparison */
+typedef struct _MetricsJob
+{
+    const unsigned char *carrier;
+    const unsigned char *stego;
+    long long length;           /* Pixel stream bytes up to the last row's end */
+    uint band_rows;
+    int bands;
+    int next_band;
+    pthread_mutex_t lock;
+    MetricsAccumulator *accs;
+} MetricsJob;
+
+/* Function Definitions */
+
+/* Metrics init
+ * Input: Accumulator, carrier geometry, optional map (width * height)
+ * Output: Returns e_success or e_failure
+ * Description: Every byte of a pixel is one channel sample, so the
+ * alpha of 32-bit pixels is measured too.
+ */
+Status metrics_init(MetricsAccumulator *acc, const CarrierInfo *carrier, unsigned char *map)
+{
+    memset(acc, 0, sizeof(*acc));
+    acc->width = carrier->width;
+    // Negative height marks a top-down BMP, the row order does not matter
+    acc->height = (int)carrier->height < 0 ? (uint)-(int)carrier->height : carrier->height;
+    acc->channels = carrier->bytes_per_pixel;
+    acc->stride = carrier->stride;
+    acc->row_bytes = carrier->width * carrier->bytes_per_pixel;
+    acc->windows = carrier->width / METRICS_WINDOW;
+    acc->map = map;
+
+    if (acc->channels == 0 || acc->channels > METRICS_MAX_CHANNELS || acc->stride < acc->row_bytes)
+    {
+        printf("\033[1;36m❌ ERROR: Metrics need 1..%d bytes per pixel\033[0m\n", METRICS_MAX_CHANNELS);
+        return e_failure;
+    }
+
+    acc->window_sums = calloc((size_t)acc->windows * acc->channels * WINDOW_SUMS + 1, sizeof(uint));
+    return acc->window_sums ? e_success : e_failure;
+}
+
+/* Release the window sums */
+void metrics_free(MetricsAccumulator *acc)
+{
+    free(acc->window_sums);
+    acc->window_sums = NULL;
+}
+
+/* Squared differences and changed bytes of n bytes (a multiple of
+ * METRICS_LANES), summed per lane position 0..METRICS_LANES-1 */
+static void lane_sums(const unsigned char *a, const unsigned char *b, long n,
+                      unsigned long long *sse, unsigned long long *changed)
+{
+    long i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+
+    while (i < n)
+    {
+        // 8-bit change counters and 32-bit squares hold 255 groups
+        __m128i count[3] = {zero, zero, zero};
+        __m128i square[3][4];
+        for (int j = 0; j < 3; j++)
+            for (int k = 0; k < 4; k++)
+                square[j][k] = zero;
+
+        for (int g = 0; g < 255 && i < n; g++, i += METRICS_LANES)
+            for (int j = 0; j < 3; j++)
+            {
+                __m128i va = _mm_loadu_si128((const __m128i *)(a + i + 16 * j));
+                __m128i vb = _mm_loadu_si128((const __m128i *)(b + i + 16 * j));
+                __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+                count[j] = _mm_add_epi8(count[j], _mm_andnot_si128(_mm_cmpeq_epi8(d, zero), one));
+
+                __m128i lo = _mm_unpacklo_epi8(d, zero), hi = _mm_unpackhi_epi8(d, zero);
+                lo = _mm_mullo_epi16(lo, lo);
+                hi = _mm_mullo_epi16(hi, hi);
+                square[j][0] = _mm_add_epi32(square[j][0], _mm_unpacklo_epi16(lo, zero));
+                square[j][1] = _mm_add_epi32(square[j][1], _mm_unpackhi_epi16(lo, zero));
+                square[j][2] = _mm_add_epi32(square[j][2], _mm_unpacklo_epi16(hi, zero));
+                square[j][3] = _mm_add_epi32(square[j][3], _mm_unpackhi_epi16(hi, zero));
+            }
+
+        for (int j = 0; j < 3; j++)
+        {
+            unsigned char c[16];
+            uint s[16];
+            _mm_storeu_si128((__m128i *)c, count[j]);
+            for (int k = 0; k < 4; k++)
+                _mm_storeu_si128((__m128i *)(s + 4 * k), square[j][k]);
+            for (int k = 0; k < 16; k++)
+            {
+                changed[16 * j + k] += c[k];
+                sse[16 * j + k] += s[k];
+            }
+        }
+    }
+#endif
+    for (; i < n; i++)
+    {
+        int d = a[i] - b[i];
+        sse[i % METRICS_LANES] += d * d;
+        changed[i % METRICS_LANES] += d != 0;
+    }
+}
+
+/* SSIM of the finished strip of 8 rows, then clear its sums */
+static void finish_strip(MetricsAccumulator *acc)
+{
+    const double n = METRICS_WINDOW * METRICS_WINDOW;
+    uint count = acc->windows * acc->channels;
+
+    for (uint w = 0; w < count; w++)
+    {
+        const uint *s = acc->window_sums + w * WINDOW_SUMS;
+        double mean_a = s[0] / n, mean_b = s[1] / n;
+        double var_a = s[2] / n - mean_a * mean_a;
+        double var_b = s[3] / n - mean_b * mean_b;
+        double cov = s[4] / n - mean_a * mean_b;
+
+        acc->ssim_sum += ((2 * mean_a * mean_b + SSIM_C1) * (2 * cov + SSIM_C2)) /
+                         ((mean_a * mean_a + mean_b * mean_b + SSIM_C1) * (var_a + var_b + SSIM_C2));
+    }
+    acc->ssim_windows += count;
+    memset(acc->window_sums, 0, (size_t)count * WINDOW_SUMS * sizeof(uint));
+}
+
+/* Measure n bytes of one row starting at byte col */
+static void measure_segment(MetricsAccumulator *acc, uint row, uint col,
+                            const unsigned char *a, const unsigned char *b, long n)
+{
+    uint ch = acc->channels;
+
+    // MSE and changed bytes: SIMD over whole lane groups, folded
+    // to channels by position in the pixel
+    long simd = n - n % METRICS_LANES;
+    unsigned long long sse[METRICS_LANES] = {0}, changed[METRICS_LANES] = {0};
+    lane_sums(a, b, simd, sse, changed);
+    for (int k = 0; k < METRICS_LANES; k++)
+    {
+        acc->sse[(col + k) % ch] += sse[k];
+        acc->changed[(col + k) % ch] += changed[k];
+    }
+
+    // Window sums and changed pixels need the pixel position
+    uint c = col % ch, px = col / ch;
+    for (long i = 0; i < n; i++)
+    {
+        int va = a[i], vb = b[i];
+        if (i >= simd)
+        {
+            acc->sse[c] += (va - vb) * (va - vb);
+            acc->changed[c] += va != vb;
+        }
+        acc->pixel_changed |= va != vb;
+
+        uint wx = px / METRICS_WINDOW;
+        if (wx < acc->windows)
+        {
+            uint *s = acc->window_sums + (wx * ch + c) * WINDOW_SUMS;
+            s[0] += va;
+            s[1] += vb;
+            s[2] += va * va;
+            s[3] += vb * vb;
+            s[4] += va * vb;
+        }
+
+        if (++c == ch)
+        {
+            if (acc->pixel_changed)
+            {
+                acc->changed_pixels++;
+                if (acc->map)
+                    acc->map[(size_t)row * acc->width + px] = 255;
+            }
+            acc->pixel_changed = 0;
+            c = 0;
+            px++;
+        }
+    }
+}
+
+/* Metrics feed
+ * Input: Accumulator, carrier and stego bytes at the accumulator's
+ *        stream offset, their count
+ * Output: None
+ * Description:
+ * Splits the bytes into row segments, skipping row padding and
+ * anything after the last row. A strip of 8 rows is turned into
+ * SSIM values as soon as its last row is complete.
+ */
+void metrics_feed(MetricsAccumulator *acc, const unsigned char *carrier, const unsigned char *stego, long len)
+{
+    while (len > 0)
+    {
+        long long row = acc->offset / acc->stride;
+        uint col = acc->offset % acc->stride;
+        long seg = acc->stride - col < (unsigned long long)len ? (long)(acc->stride - col) : len;
+
+        if (row < acc->height && col < acc->row_bytes)
+        {
+            long n = acc->row_bytes - col < (unsigned long long)seg ? (long)(acc->row_bytes - col) : seg;
+            measure_segment(acc, row, col, carrier, stego, n);
+            if (col + n == acc->row_bytes && row % METRICS_WINDOW == METRICS_WINDOW - 1)
+                finish_strip(acc);
+        }
+
+        carrier += seg;
+        stego += seg;
+        len -= seg;
+        acc->offset += seg;
+    }
+}
+
+/* Metrics result
+ * Input: Accumulators (bands of one image), their count, result
+ * Output: None
+ * Description: PSNR is taken over the MSE of all channels together,
+ * SSIM is the mean over all windows and channels.
+ */
+void metrics_result(MetricsAccumulator *accs, int count, MetricsResult *result)
+{
+    unsigned long long sse[METRICS_MAX_CHANNELS] = {0}, sse_total = 0;
+    double ssim_sum = 0;
+    unsigned long long ssim_windows = 0;
+
+    memset(result, 0, sizeof(*result));
+    result->channels = accs[0].channels;
+    result->pixels = (unsigned long long)accs[0].width * accs[0].height;
+
+    for (int i = 0; i < count; i++)
+    {
+        for (uint c = 0; c < result->channels; c++)
+        {
+            sse[c] += accs[i].sse[c];
+            result->changed[c] += accs[i].changed[c];
+        }
+        result->changed_pixels += accs[i].changed_pixels;
+        ssim_sum += accs[i].ssim_sum;
+        ssim_windows += accs[i].ssim_windows;
+    }
+
+    for (uint c = 0; c < result->channels; c++)
+    {
+        result->mse[c] = result->pixels ? (double)sse[c] / result->pixels : 0;
+        sse_total += sse[c];
+    }
+    result->mse_total = result->pixels ? (double)sse_total / (result->pixels * result->channels) : 0;
+    result->psnr = result->mse_total > 0 ? 10 * log10(255.0 * 255.0 / result->mse_total) : INFINITY;
+    result->ssim = ssim_windows ? ssim_sum / ssim_windows : 1.0;
+}
+
+/* Print a result on one line */
+void metrics_print(const char *label, const MetricsResult *result)
+{
+    printf("%s: PSNR %.2f dB  SSIM %.6f  MSE %.6f (", label, result->psnr, result->ssim, result->mse_total);
+    for (uint c = 0; c < result->channels; c++)
+        printf("%s%.6f", c ? " " : "", result->mse[c]);
+    printf(")  changed pixels %llu / %llu (%.2f%%)  changed bytes (",
+           result->changed_pixels, result->pixels,
+           result->pixels ? 100.0 * result->changed_pixels / result->pixels : 0.0);
+    for (uint c = 0; c < result->channels; c++)
+        printf("%s%llu", c ? " " : "", result->changed[c]);
+    printf(")\n");
+}
+
+/* Worker thread: take bands of rows until none are left */
+static void *metrics_worker(void *arg)
+{
+    MetricsJob *job = arg;
+    for (;;)
+    {
+        pthread_mutex_lock(&job->lock);
+        int band = job->next_band++;
+        pthread_mutex_unlock(&job->lock);
+        if (band >= job->bands)
+            break;
+
+        // Bands start on a strip boundary, so windows never straddle two
+        MetricsAccumulator *acc = &job->accs[band];
+        long long begin = (long long)band * job->band_rows * acc->stride;
+        long long end = begin + (long long)job->band_rows * acc->stride;
+        if (end > job->length)
+            end = job->length;
+        acc->offset = begin;
+        metrics_feed(acc, job->carrier + begin, job->stego + begin, end - begin);
+    }
+    return NULL;
+}
+
+/* Open, probe and map one image read-only */
+static unsigned char *map_image(const char *fname, const StegoOptions *opts, CarrierInfo *carrier, size_t *size)
+{
+    FILE *fptr = fopen(fname, "rb");
+    if (fptr == NULL)
+    {
+        perror("fopen");
+        return NULL;
+    }
+
+    struct stat st;
+    unsigned char *map = NULL;
+    if (carrier_format_from_name(fname, opts, &carrier->format) != e_success)
+        printf("\033[1;36m❌ ERROR: %s is not a .bmp, .ppm, .pam or --raw carrier\033[0m\n", fname);
+    else if (probe_carrier(fptr, opts, carrier) == e_success && fstat(fileno(fptr), &st) == 0 && st.st_size > 0)
+    {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fptr), 0);
+        if (map == MAP_FAILED)
+        {
+            perror("mmap");
+            map = NULL;
+        }
+        else
+        {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            *size = st.st_size;
+        }
+    }
+    fclose(fptr);
+    return map;
+}
+
+/* Write the changed-pixel map as an 8-bit PGM, top row first */
+static Status write_pixel_map(const char *fname, const unsigned char *map, uint width, uint height, int bottom_up)
+{
+    FILE *fptr = fopen(fname, "wb");
+    if (fptr == NULL)
+    {
+        perror("fopen");
+        return e_failure;
+    }
+
+    Status ret = fprintf(fptr, "P5\n%u %u\n255\n", width, height) > 0 ? e_success : e_failure;
+    for (uint y = 0; ret == e_success && y < height; y++)
+    {
+        uint row = bottom_up ? height - 1 - y : y;
+        if (fwrite(map + (size_t)row * width, 1, width, fptr) != width)
+            ret = e_failure;
+    }
+    if (fclose(fptr) != 0)
+        ret = e_failure;
+    return ret;
+}
+
+/* Compare images
+ * Input: argc, argv (-m <carrier> <stego> [map.pgm] [--raw=...])
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Maps both images, checks that they share one geometry and lets
+ * one thread per core measure bands of rows. With a third name a
+ * PGM map is written, white where any byte of a pixel changed.
+ */
+Status do_metrics(int argc, char *argv[])
+{
+    StegoOptions opts = {0};
+    if (parse_stego_options(&argc, argv, &opts) != e_success)
+        return e_failure;
+    if (argc != 4 && argc != 5)
+    {
+        printf("\033[1;36m❌ ERROR: Usage: ./a.out -m <carrier> <stego> [map.pgm] [--raw=WxH[xC][:stride]]\033[0m\n");
+        return e_failure;
+    }
+
+    CarrierInfo carrier = {0}, stego = {0};
+    size_t carrier_size = 0, stego_size = 0;
+    unsigned char *carrier_map = map_image(argv[2], &opts, &carrier, &carrier_size);
+    unsigned char *stego_map = carrier_map ? map_image(argv[3], &opts, &stego, &stego_size) : NULL;
+    Status ret = stego_map ? e_success : e_failure;
+
+    if (ret == e_success && (carrier.format != stego.format || carrier.width != stego.width ||
+                             carrier.height != stego.height || carrier.bytes_per_pixel != stego.bytes_per_pixel ||
+                             carrier.stride != stego.stride))
+    {
+        printf("\033[1;36m❌ ERROR: %s and %s do not have the same geometry\033[0m\n", argv[2], argv[3]);
+        ret = e_failure;
+    }
+
+    MetricsJob job = {0};
+    MetricsAccumulator accs[METRICS_BANDS];
+    unsigned char *pixel_map = NULL;
+    int ready = 0;
+
+    if (ret == e_success)
+    {
+        uint height = (int)carrier.height < 0 ? (uint)-(int)carrier.height : carrier.height;
+        job.length = (long long)carrier.stride * (height - 1) + carrier.width * carrier.bytes_per_pixel;
+        if (height == 0 || carrier.width == 0 || carrier.pixel_offset + job.length > (long long)carrier_size ||
+            stego.pixel_offset + job.length > (long long)stego_size)
+        {
+            printf("\033[1;36m❌ ERROR: Image is shorter than its %u x %u pixels\033[0m\n", carrier.width, height);
+            ret = e_failure;
+        }
+        else if (argc == 5 && (pixel_map = calloc((size_t)carrier.width * height, 1)) == NULL)
+            ret = e_failure;
+
+        // Whole strips of 8 rows per band
+        job.band_rows = (height + METRICS_BANDS - 1) / METRICS_BANDS;
+        job.band_rows = (job.band_rows + METRICS_WINDOW - 1) / METRICS_WINDOW * METRICS_WINDOW;
+        job.bands = (height + job.band_rows - 1) / job.band_rows;
+    }
+
+    for (; ret == e_success && ready < job.bands; ready++)
+        ret = metrics_init(&accs[ready], &carrier, pixel_map);
+
+    if (ret == e_success)
+    {
+        job.carrier = carrier_map + carrier.pixel_offset;
+        job.stego = stego_map + stego.pixel_offset;
+        job.accs = accs;
+        pthread_mutex_init(&job.lock, NULL);
+
+        int n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (n_threads < 1)
+            n_threads = 1;
+        if (n_threads > job.bands)
+            n_threads = job.bands;
+        // Workers take bands until none are left, so a thread that
+        // cannot be started just leaves its bands to the others
+        pthread_t threads[METRICS_BANDS];
+        int started = 1;
+        while (started < n_threads && pthread_create(&threads[started], NULL, metrics_worker, &job) == 0)
+            started++;
+        metrics_worker(&job);
+        for (int t = 1; t < started; t++)
+            pthread_join(threads[t], NULL);
+        pthread_mutex_destroy(&job.lock);
+
+        MetricsResult result;
+        metrics_result(accs, job.bands, &result);
+        metrics_print(argv[3], &result);
+
+        if (pixel_map)
+        {
+            int bottom_up = carrier.format == e_carrier_bmp && (int)carrier.height > 0;
+            ret = write_pixel_map(argv[4], pixel_map, carrier.width, accs[0].height, bottom_up);
+            if (ret == e_success)
+                printf("\033[1;36m🗺️  Changed-pixel map written to %s\033[0m\n", argv[4]);
+        }
+    }
+
+    while (ready > 0)
+        metrics_free(&accs[--ready]);
+    free(pixel_map);
+    if (carrier_map)
+        munmap(carrier_map, carrier_size);
+    if (stego_map)
+        munmap(stego_map, stego_size);
+    return ret;
+}
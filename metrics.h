@@ -0,0 +1,86 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "types.h"   // Contains user defined types
+#include "carrier.h" // Carrier geometry
+
+/*
+ * Distortion between a carrier and its stego image: per-channel
+ * MSE, PSNR, changed bytes / pixels and SSIM over 8x8 windows.
+ *
+ * An accumulator consumes the pixel bytes of both images as one
+ * stream in file order (row padding is skipped), so the same code
+ * serves the -m mode, where threads take bands of rows of two
+ * mapped images, and --metrics, which is fed the carrier and stego
+ * chunks the encoder already has in memory.
+ */
+
+#define METRICS_MAX_CHANNELS 4
+#define METRICS_WINDOW 8
+#define METRICS_BANDS 64
+
+/* Bytes of one SIMD lane group: a multiple of 16 and of 1..4 channels */
+#define METRICS_LANES 48
+
+typedef struct _MetricsAccumulator
+{
+    /* Geometry */
+    uint width;
+    uint height;
+    uint channels;
+    uint stride;
+    uint row_bytes;
+
+    /* Stream position, bytes from the first pixel byte */
+    long long offset;
+
+    unsigned long long sse[METRICS_MAX_CHANNELS];
+    unsigned long long changed[METRICS_MAX_CHANNELS];
+    unsigned long long changed_pixels;
+    int pixel_changed;          /* Current pixel, may span two feeds */
+
+    /* Window sums of the current strip of 8 rows:
+     * per window and channel a, b, a*a, b*b, a*b */
+    uint *window_sums;
+    uint windows;               /* Full windows per row */
+    double ssim_sum;
+    unsigned long long ssim_windows;
+
+    /* Optional changed-pixel map, width * height, file row order */
+    unsigned char *map;
+} MetricsAccumulator;
+
+typedef struct _MetricsResult
+{
+    uint channels;
+    double mse[METRICS_MAX_CHANNELS];
+    double mse_total;
+    double psnr;                /* dB, infinite for identical images */
+    double ssim;
+    unsigned long long changed[METRICS_MAX_CHANNELS];
+    unsigned long long changed_pixels;
+    unsigned long long pixels;
+} MetricsResult;
+
+
+/* Metrics function prototype */
+
+/* Compare carrier and stego: -m <carrier> <stego> [map.pgm] [--raw=...] */
+Status do_metrics(int argc, char *argv[]);
+
+/* Set up an accumulator for a carrier geometry, with or without a map */
+Status metrics_init(MetricsAccumulator *acc, const CarrierInfo *carrier, unsigned char *map);
+
+/* Consume len pixel-stream bytes of carrier and stego */
+void metrics_feed(MetricsAccumulator *acc, const unsigned char *carrier, const unsigned char *stego, long len);
+
+/* Fold the sums of several accumulators into one result */
+void metrics_result(MetricsAccumulator *accs, int count, MetricsResult *result);
+
+/* Print a result on one line */
+void metrics_print(const char *label, const MetricsResult *result);
+
+/* Release the window sums */
+void metrics_free(MetricsAccumulator *acc);
+
+#endif
@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "options.h"
+#include "ecc.h"
+#include "matrix.h"
+#include "types.h"
+
+/* Function Definitions */
+
+/* Parse options
+ * Input: Pointer to argc, argv and options structure
+ * Output: Returns e_success or e_failure on unknown option
+ * Description:
+ * Every argument starting with "--" is consumed and removed from
+ * argv, so the positional checks in the validators see the same
+ * layout as before options existed.
+ */
+Status parse_stego_options(int *argc, char *argv[], StegoOptions *opts)
+{
+    int kept = 0;
+    for (int i = 0; i < *argc; i++)
+    {
+        // Keep positional arguments in their original order
+        if (i < 2 || strncmp(argv[i], "--", 2) != 0)
+        {
+            argv[kept++] = argv[i];
+            continue;
+        }
+
+        if (strcmp(argv[i], "--pipeline") == 0)
+            opts->flags |= OPT_PIPELINE;
+        else if (strcmp(argv[i], "--resume") == 0)
+            opts->flags |= OPT_RESUME;
+        else if (strcmp(argv[i], "--direct") == 0)
+            opts->flags |= OPT_DIRECT;
+        else if (strcmp(argv[i], "--explain") == 0)
+            opts->flags |= OPT_EXPLAIN;
+        else if (strcmp(argv[i], "--dedup") == 0)
+            opts->flags |= OPT_DEDUP;
+        else if (strcmp(argv[i], "--metrics") == 0)
+            opts->flags |= OPT_METRICS;
+        else if (strcmp(argv[i], "--alpha") == 0)
+            opts->flags |= OPT_ALPHA;
+        else if (strcmp(argv[i], "--legacy-header") == 0)
+            opts->flags |= OPT_LEGACY_HEADER;
+        else if (strcmp(argv[i], "--ecc") == 0 || strncmp(argv[i], "--ecc=", 6) == 0)
+        {
+            opts->flags |= OPT_ECC;
+            opts->ecc_nsym = argv[i][5] == '=' ? atoi(argv[i] + 6) : ECC_DEFAULT_NSYM;
+            if (opts->ecc_nsym < 2 || opts->ecc_nsym > ECC_MAX_NSYM)
+            {
+                printf("\033[1;36m❌ ERROR: --ecc needs 2..%d parity bytes\033[0m\n", ECC_MAX_NSYM);
+                return e_failure;
+            }
+        }
+        else if (strcmp(argv[i], "--matrix") == 0 || strncmp(argv[i], "--matrix=", 9) == 0)
+        {
+            opts->flags |= OPT_MATRIX;
+            opts->matrix_k = argv[i][8] == '=' ? (uint)atoi(argv[i] + 9) : MATRIX_DEFAULT_K;
+            if (!matrix_k_supported(opts->matrix_k))
+            {
+                printf("\033[1;36m❌ ERROR: --matrix needs k = 2 or 4\033[0m\n");
+                return e_failure;
+            }
+        }
+        else if (strncmp(argv[i], "--cache=", 8) == 0 && argv[i][8] != '\0')
+        {
+            opts->flags |= OPT_CACHE;
+            opts->cache_dir = argv[i] + 8;
+        }
+        else if (strncmp(argv[i], "--cache-max=", 12) == 0)
+        {
+            // Bytes, or KiB / MiB / GiB with a suffix
+            char *end;
+            opts->cache_max = strtoll(argv[i] + 12, &end, 10);
+            if (*end == 'K' || *end == 'k')
+                opts->cache_max <<= 10, end++;
+            else if (*end == 'M' || *end == 'm')
+                opts->cache_max <<= 20, end++;
+            else if (*end == 'G' || *end == 'g')
+                opts->cache_max <<= 30, end++;
+            if (end == argv[i] + 12 || *end != '\0' || opts->cache_max <= 0)
+            {
+                printf("\033[1;36m❌ ERROR: --cache-max needs a size like 512M\033[0m\n");
+                return e_failure;
+            }
+        }
+        else if (strncmp(argv[i], "--raw=", 6) == 0)
+        {
+            opts->flags |= OPT_RAW;
+            opts->raw_channels = 3;
+            opts->raw_stride = 0;
+
+            // WxH, then optional xC and :stride
+            const char *p = argv[i] + 6;
+            int n = 0;
+            if (sscanf(p, "%ux%u%n", &opts->raw_width, &opts->raw_height, &n) != 2)
+                n = 0;
+            p += n;
+            if (n > 0 && *p == 'x')
+                p += sscanf(p, "x%u%n", &opts->raw_channels, &n) == 1 ? n : 0;
+            if (n > 0 && *p == ':')
+                p += sscanf(p, ":%u%n", &opts->raw_stride, &n) == 1 ? n : 0;
+
+            if (n == 0 || *p != '\0' || opts->raw_width == 0 || opts->raw_height == 0 ||
+                opts->raw_channels == 0 || opts->raw_channels > 4)
+            {
+                printf("\033[1;36m❌ ERROR: --raw needs <width>x<height>[x<channels>][:<stride>]\033[0m\n");
+                return e_failure;
+            }
+        }
+        else
+        {
+            printf("\033[1;36m❌ ERROR: Unknown option %s\033[0m\n", argv[i]);
+            return e_failure;
+        }
+    }
+    *argc = kept;
+    argv[kept] = NULL;
+    return e_success;
+}
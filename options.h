@@ -0,0 +1,52 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * Optional "--name" / "--name=value" switches accepted after
+ * the positional arguments of -e and -d.
+ */
+
+/* Option flags */
+#define OPT_PIPELINE      (1u << 0)  /* Overlap read, embed/extract and write */
+#define OPT_LEGACY_HEADER (1u << 1)  /* Write the version 1 header */
+#define OPT_ECC           (1u << 2)  /* Reed-Solomon protect header and data */
+#define OPT_RAW           (1u << 3)  /* Headerless pixel buffer carrier */
+#define OPT_ALPHA         (1u << 4)  /* Whole payload bytes in the alpha byte */
+#define OPT_RESUME        (1u << 5)  /* Continue from the last checkpoint */
+#define OPT_METRICS       (1u << 6)  /* Report PSNR / SSIM of the stego image */
+#define OPT_EXPLAIN       (1u << 7)  /* Print the chosen I/O strategy */
+#define OPT_MATRIX        (1u << 8)  /* Hamming matrix embedding of the payload */
+#define OPT_DEDUP         (1u << 9)  /* Store repeated payload chunks once */
+#define OPT_CACHE         (1u << 10) /* Serve identical encodes from a cache */
+#define OPT_DIRECT        (1u << 11) /* O_DIRECT carrier I/O, no page cache */
+
+typedef struct _StegoOptions
+{
+    uint flags;
+
+    /* --ecc[=N]: parity bytes per 255-byte codeword */
+    int ecc_nsym;
+
+    /* --matrix[=K]: Hamming code parameter (2 or 4) */
+    uint matrix_k;
+
+    /* --cache=DIR, --cache-max=N[K|M|G]: result cache and its size bound */
+    const char *cache_dir;
+    long long cache_max;
+
+    /* --raw=WxH[xC][:stride]: geometry of a headerless carrier */
+    uint raw_width;
+    uint raw_height;
+    uint raw_channels;
+    uint raw_stride;
+} StegoOptions;
+
+
+/* Options function prototype */
+
+/* Remove "--" options from argv, store them in opts, update argc */
+Status parse_stego_options(int *argc, char *argv[], StegoOptions *opts);
+
+#endif
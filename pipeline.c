@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "pipeline.h"
+#include "encode.h"
+#include "decode.h"
+#include "common.h"
+#include "stego_header.h"
+#include "types.h"
+
+/* Shared ring state, guarded by lock */
+typedef struct _Pipeline
+{
+    PipeSlot slots[PIPE_SLOTS];
+
+    /* Slots completed by each stage so far */
+    long read_done;
+    long transform_done;
+    long write_done;
+    int failed;
+
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+
+    PipeStageFn transform_fn;
+    PipeStageFn write_fn;
+    void *ctx;
+} Pipeline;
+
+/* Function Definitions */
+
+/* Mark one more slot done by a stage, or the whole pipeline failed */
+static void finish_slot(Pipeline *pipe, long *done, Status status)
+{
+    pthread_mutex_lock(&pipe->lock);
+    if (status == e_success)
+        (*done)++;
+    else
+        pipe->failed = 1;
+    pthread_cond_broadcast(&pipe->changed);
+    pthread_mutex_unlock(&pipe->lock);
+}
+
+/* Wait until the upstream stage has produced slot n, 0 on failure */
+static int wait_for_slot(Pipeline *pipe, long *upstream_done, long n)
+{
+    pthread_mutex_lock(&pipe->lock);
+    while (*upstream_done <= n && !pipe->failed)
+        pthread_cond_wait(&pipe->changed, &pipe->lock);
+    int ok = !pipe->failed;
+    pthread_mutex_unlock(&pipe->lock);
+    return ok;
+}
+
+/* Transform stage thread */
+static void *transform_main(void *arg)
+{
+    Pipeline *pipe = arg;
+    for (long n = 0; wait_for_slot(pipe, &pipe->read_done, n); n++)
+    {
+        PipeSlot *slot = &pipe->slots[n % PIPE_SLOTS];
+        Status status = pipe->transform_fn(slot, pipe->ctx);
+
+        // Once finished, the reader may refill the slot, read last first
+        int last = slot->last;
+        finish_slot(pipe, &pipe->transform_done, status);
+        if (last)
+            break;
+    }
+    return NULL;
+}
+
+/* Writer stage thread */
+static void *write_main(void *arg)
+{
+    Pipeline *pipe = arg;
+    for (long n = 0; wait_for_slot(pipe, &pipe->transform_done, n); n++)
+    {
+        PipeSlot *slot = &pipe->slots[n % PIPE_SLOTS];
+        Status status = pipe->write_fn(slot, pipe->ctx);
+
+        // Once finished, the reader may refill the slot, read last first
+        int last = slot->last;
+        finish_slot(pipe, &pipe->write_done, status);
+        if (last)
+            break;
+    }
+    return NULL;
+}
+
+/* Run pipeline
+ * Input: Stage callbacks, their shared context, carrier bytes per
+ *        payload byte
+ * Output: Returns e_success if every slot went through all stages
+ * Description:
+ * The calling thread is the reader: it refills a slot as soon as
+ * the writer has released it, so at most PIPE_SLOTS chunks are in
+ * flight. Transform and writer run in their own threads and take
+ * slots strictly in order.
+ */
+Status run_pipeline(PipeStageFn read_fn, PipeStageFn transform_fn, PipeStageFn write_fn, void *ctx, long span)
+{
+    Pipeline pipe = {0};
+    Status ret = e_success;
+
+    for (int i = 0; i < PIPE_SLOTS; i++)
+    {
+        pipe.slots[i].payload = malloc(STEGO_CHUNK_SIZE);
+        pipe.slots[i].carrier = malloc(STEGO_CHUNK_SIZE * span);
+        if (!pipe.slots[i].payload || !pipe.slots[i].carrier)
+            ret = e_failure;
+    }
+
+    pthread_t transform_thread, write_thread;
+    pipe.transform_fn = transform_fn;
+    pipe.write_fn = write_fn;
+    pipe.ctx = ctx;
+    pthread_mutex_init(&pipe.lock, NULL);
+    pthread_cond_init(&pipe.changed, NULL);
+
+    if (ret == e_success)
+    {
+        // A stage that cannot start fails the pipeline before any read
+        int transform_started = pthread_create(&transform_thread, NULL, transform_main, &pipe) == 0;
+        int write_started = transform_started && pthread_create(&write_thread, NULL, write_main, &pipe) == 0;
+        if (!write_started)
+        {
+            pthread_mutex_lock(&pipe.lock);
+            pipe.failed = 1;
+            pthread_cond_broadcast(&pipe.changed);
+            pthread_mutex_unlock(&pipe.lock);
+        }
+
+        for (long n = 0; ; n++)
+        {
+            // Slot n is free once the writer is done with slot n - PIPE_SLOTS
+            if (!wait_for_slot(&pipe, &pipe.write_done, n - PIPE_SLOTS))
+                break;
+
+            PipeSlot *slot = &pipe.slots[n % PIPE_SLOTS];
+            slot->last = 0;
+            finish_slot(&pipe, &pipe.read_done, read_fn(slot, ctx));
+            if (slot->last)
+                break;
+        }
+
+        if (transform_started)
+            pthread_join(transform_thread, NULL);
+        if (write_started)
+            pthread_join(write_thread, NULL);
+        if (pipe.failed)
+            ret = e_failure;
+    }
+
+    for (int i = 0; i < PIPE_SLOTS; i++)
+    {
+        free(pipe.slots[i].payload);
+        free(pipe.slots[i].carrier);
+    }
+    pthread_mutex_destroy(&pipe.lock);
+    pthread_cond_destroy(&pipe.changed);
+    return ret;
+}
+
+/* Encode stages: the context is the EncodeInfo, remaining bytes tracked in slot order */
+typedef struct _EncodePipeCtx
+{
+    EncodeInfo *encInfo;
+    long remaining;
+    long span;          /* Carrier bytes per secret byte */
+    long done;          /* Secret bytes written, for checkpoints */
+} EncodePipeCtx;
+
+static Status encode_read_stage(PipeSlot *slot, void *arg)
+{
+    EncodePipeCtx *ctx = arg;
+    long n = ctx->remaining < STEGO_CHUNK_SIZE ? ctx->remaining : STEGO_CHUNK_SIZE;
+
+    if (fread(slot->payload, 1, n, ctx->encInfo->fptr_secret) != (size_t)n)
+        return e_failure;
+    if (fread(slot->carrier, 1, n * ctx->span, ctx->encInfo->fptr_src_image) != (size_t)(n * ctx->span))
+        return e_failure;
+
+    slot->payload_len = n;
+    ctx->remaining -= n;
+    slot->last = ctx->remaining == 0;
+    return e_success;
+}
+
+static Status encode_transform_stage(PipeSlot *slot, void *arg)
+{
+    EncodePipeCtx *ctx = arg;
+    return encode_payload_chunk(ctx->encInfo, slot->payload, slot->payload_len, slot->carrier);
+}
+
+static Status encode_write_stage(PipeSlot *slot, void *arg)
+{
+    EncodePipeCtx *ctx = arg;
+    long len = slot->payload_len * ctx->span;
+    if (fwrite(slot->carrier, 1, len, ctx->encInfo->fptr_stego_image) != (size_t)len)
+        return e_failure;
+
+    ctx->done += slot->payload_len;
+    return checkpoint_progress(&ctx->encInfo->ckpt, ctx->encInfo->fptr_stego_image, slot->carrier, len, ctx->done);
+}
+
+/* Encode secret file data, pipelined
+ * Input: EncodeInfo structure, files positioned at the data region
+ * Output: Returns e_success or e_failure
+ * Description: Same result as encode_secret_file_data, with
+ * reading, LSB embedding and writing overlapped.
+ */
+Status encode_secret_file_data_pipelined(EncodeInfo *encInfo)
+{
+    long start = encInfo->ckpt.payload_done;
+    EncodePipeCtx ctx = { encInfo, encInfo->size_secret_file - start, stego_payload_span(encInfo->header_flags), start };
+    return run_pipeline(encode_read_stage, encode_transform_stage, encode_write_stage, &ctx, ctx.span);
+}
+
+/* Decode stages */
+typedef struct _DecodePipeCtx
+{
+    DecodeInfo *decInfo;
+    long remaining;
+    long span;
+    long done;
+} DecodePipeCtx;
+
+static Status decode_read_stage(PipeSlot *slot, void *arg)
+{
+    DecodePipeCtx *ctx = arg;
+    long n = ctx->remaining < STEGO_CHUNK_SIZE ? ctx->remaining : STEGO_CHUNK_SIZE;
+
+    if (fread(slot->carrier, 1, n * ctx->span, ctx->decInfo->fptr_stego_image) != (size_t)(n * ctx->span))
+        return e_failure;
+
+    slot->payload_len = n;
+    ctx->remaining -= n;
+    slot->last = ctx->remaining == 0;
+    return e_success;
+}
+
+static Status decode_transform_stage(PipeSlot *slot, void *arg)
+{
+    DecodePipeCtx *ctx = arg;
+    return decode_payload_chunk(ctx->decInfo, slot->payload, slot->payload_len, slot->carrier);
+}
+
+static Status decode_write_stage(PipeSlot *slot, void *arg)
+{
+    DecodePipeCtx *ctx = arg;
+    if (fwrite(slot->payload, 1, slot->payload_len, ctx->decInfo->fptr_secret) != (size_t)slot->payload_len)
+        return e_failure;
+
+    ctx->done += slot->payload_len;
+    return checkpoint_progress(&ctx->decInfo->ckpt, ctx->decInfo->fptr_secret, slot->payload, slot->payload_len, ctx->done);
+}
+
+/* Decode secret file data, pipelined
+ * Input: DecodeInfo structure, stego positioned at the data region
+ * Output: Returns e_success or e_failure
+ * Description: Same result as decode_secret_file_data, with
+ * reading, LSB extraction and writing overlapped.
+ */
+Status decode_secret_file_data_pipelined(DecodeInfo *decInfo)
+{
+    long start = decInfo->ckpt.payload_done;
+    DecodePipeCtx ctx = { decInfo, decInfo->size_secret_file - start, stego_payload_span(decInfo->header_flags), start };
+    return run_pipeline(decode_read_stage, decode_transform_stage, decode_write_stage, &ctx, ctx.span);
+}
@@ -0,0 +1,32 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * Three-stage pipeline: reader, transform and writer threads
+ * connected by a bounded ring of slots. While the writer stores
+ * chunk n-1 and the transform embeds chunk n, the reader is
+ * already fetching chunk n+1.
+ */
+
+#define PIPE_SLOTS 4
+
+typedef struct _PipeSlot
+{
+    unsigned char *payload;     /* Secret bytes (STEGO_CHUNK_SIZE) */
+    unsigned char *carrier;     /* Image bytes (STEGO_CHUNK_SIZE * span) */
+    long payload_len;           /* Secret bytes valid in this slot */
+    int last;                   /* Final slot of the stream */
+} PipeSlot;
+
+/* Stage callback: fill, transform or drain one slot */
+typedef Status (*PipeStageFn)(PipeSlot *slot, void *ctx);
+
+
+/* Pipeline function prototype */
+
+/* Run read -> transform -> write over the ring until the reader marks the last slot */
+Status run_pipeline(PipeStageFn read_fn, PipeStageFn transform_fn, PipeStageFn write_fn, void *ctx, long span);
+
+#endif
@@ -0,0 +1,290 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include "result_cache.h"
+#include "io_strategy.h"
+#include "sha256.h"
+#include "types.h"
+
+/* One entry seen while evicting */
+typedef struct _CacheEntry
+{
+    char name[RESULT_CACHE_ENTRY_MAX];
+    long long size;
+    struct timespec used;
+} CacheEntry;
+
+/* Function Definitions */
+
+/* Name of a serve method */
+const char *result_cache_serve_name(CacheServe how)
+{
+    switch (how)
+    {
+        case e_cache_reflink:  return "reflink";
+        default:               return "copy";
+    }
+}
+
+/* Hash the size and the bytes of a regular file, size to *size */
+static Status hash_content(Sha256 *ctx, const char *fname, unsigned char *buffer, long long *size)
+{
+    struct stat st;
+    ssize_t n;
+    long long done = 0;
+
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        if (fd >= 0)
+            close(fd);
+        return e_failure;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    *size = st.st_size;
+    sha256_update(ctx, size, sizeof(*size));
+    for (;;)
+    {
+        n = read(fd, buffer, RESULT_CACHE_HASH_BLOCK);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        sha256_update(ctx, buffer, n);
+        done += n;
+    }
+    close(fd);
+
+    // A file that changed size while read is not keyed
+    return n == 0 && done == *size ? e_success : e_failure;
+}
+
+/* Entry file name of a key, without the directory */
+static void entry_name(char *name, size_t size, const ResultCacheKey *key, const char *suffix)
+{
+    int len = 0;
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++)
+        len += snprintf(name + len, size - len, "%02x", key->digest[i]);
+    snprintf(name + len, size - len, "-%lld-%lld%s", key->carrier_size, key->secret_size, suffix);
+}
+
+/* Cache key
+ * Input: Carrier and secret file names, parameter bytes and their count, key to fill
+ * Output: Returns e_success, or e_failure when an input is not a readable regular file
+ * Description: The digest is over the contents, not the names, so
+ * identical inputs at other paths hit and any rewrite misses. The
+ * parameters are the caller's: everything that changes the output
+ * bytes and nothing that does not. The input sizes are kept beside
+ * the digest and go into the entry name.
+ */
+Status result_cache_key(const char *carrier_fname, const char *secret_fname, const void *params, long len, ResultCacheKey *key)
+{
+    int version = RESULT_CACHE_VERSION;
+    Sha256 ctx;
+    Status ret = e_failure;
+
+    memset(key, 0, sizeof(*key));
+    unsigned char *buffer = malloc(RESULT_CACHE_HASH_BLOCK);
+    if (buffer == NULL)
+        return e_failure;
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, "r", 1);
+    sha256_update(&ctx, &version, sizeof(version));
+    if (hash_content(&ctx, carrier_fname, buffer, &key->carrier_size) == e_success &&
+        hash_content(&ctx, secret_fname, buffer, &key->secret_size) == e_success && key->carrier_size > 0)
+    {
+        sha256_update(&ctx, params, len);
+        sha256_final(&ctx, key->digest);
+        ret = e_success;
+    }
+    free(buffer);
+
+    if (ret != e_success)
+        memset(key, 0, sizeof(*key));
+    return ret;
+}
+
+/* Serve from cache
+ * Input: Cache directory, key, output name, serve method to fill
+ * Output: Returns e_success on a hit, e_failure on a miss
+ * Description:
+ * An entry whose size is not the carrier size (truncated, or not
+ * written by this cache) is a miss. The entry goes to a temporary name beside the output, by reflink
+ * or else kernel copy, and is renamed over the output so a reader
+ * never sees a partial file. Never by hardlink: the output is the
+ * user's own, writable file sharing no inode with the cache. A hit
+ * touches the entry's mtime, the LRU clock.
+ */
+Status result_cache_serve(const char *dir, const ResultCacheKey *key, const char *out_fname, CacheServe *how)
+{
+    char name[RESULT_CACHE_ENTRY_MAX], entry[RESULT_CACHE_NAME_MAX], tmp[RESULT_CACHE_NAME_MAX];
+    struct stat st;
+    int reflinked;
+    Status ret = e_failure;
+
+    entry_name(name, sizeof(name), key, RESULT_CACHE_SUFFIX);
+    snprintf(entry, sizeof(entry), "%s/%s", dir, name);
+    snprintf(tmp, sizeof(tmp), "%s.cache.%ld", out_fname, (long)getpid());
+
+    int fd_in = open(entry, O_RDONLY);
+    if (fd_in < 0)
+        return e_failure;
+    if (fstat(fd_in, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size != key->carrier_size)
+    {
+        close(fd_in);
+        return e_failure;
+    }
+
+    // Shared extents: a private, writable output at no cost
+    int fd_out = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_out >= 0 && ioctl(fd_out, FICLONE, fd_in) == 0)
+    {
+        *how = e_cache_reflink;
+        ret = e_success;
+    }
+    if (fd_out >= 0)
+        close(fd_out);
+
+    // No shared extents here: the kernel copies the bytes
+    if (ret != e_success)
+    {
+        fd_out = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd_out >= 0 && io_clone_file(fd_in, fd_out, st.st_size, &reflinked) == e_success)
+        {
+            *how = e_cache_copy;
+            ret = e_success;
+        }
+        if (fd_out >= 0 && close(fd_out) != 0)
+            ret = e_failure;
+    }
+    close(fd_in);
+
+    if (ret == e_success && rename(tmp, out_fname) != 0)
+        ret = e_failure;
+    if (ret != e_success)
+    {
+        unlink(tmp);
+        return e_failure;
+    }
+
+    utimensat(AT_FDCWD, entry, NULL, 0);
+    return e_success;
+}
+
+/* Oldest entry first */
+static int compare_used(const void *a, const void *b)
+{
+    const CacheEntry *x = a, *y = b;
+    if (x->used.tv_sec != y->used.tv_sec)
+        return x->used.tv_sec < y->used.tv_sec ? -1 : 1;
+    if (x->used.tv_nsec != y->used.tv_nsec)
+        return x->used.tv_nsec < y->used.tv_nsec ? -1 : 1;
+    return 0;
+}
+
+/* Remove least recently used entries until the directory fits */
+static void evict_entries(const char *dir, long long max_bytes)
+{
+    DIR *d = opendir(dir);
+    if (d == NULL)
+        return;
+
+    CacheEntry *entries = NULL;
+    long count = 0, capacity = 0;
+    long long total = 0;
+    struct dirent *de;
+    struct stat st;
+
+    while ((de = readdir(d)) != NULL)
+    {
+        size_t len = strlen(de->d_name), suffix = strlen(RESULT_CACHE_SUFFIX);
+        if (len <= suffix || len >= sizeof(entries->name) ||
+            strcmp(de->d_name + len - suffix, RESULT_CACHE_SUFFIX) != 0 ||
+            fstatat(dirfd(d), de->d_name, &st, 0) != 0)
+            continue;
+
+        if (count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64;
+            CacheEntry *grown = realloc(entries, capacity * sizeof(*entries));
+            if (grown == NULL)
+                break;
+            entries = grown;
+        }
+        strcpy(entries[count].name, de->d_name);
+        entries[count].size = st.st_size;
+        entries[count].used = st.st_mtim;
+        total += st.st_size;
+        count++;
+    }
+
+    qsort(entries, count, sizeof(*entries), compare_used);
+    for (long i = 0; i < count && total > max_bytes; i++)
+        if (unlinkat(dirfd(d), entries[i].name, 0) == 0)
+            total -= entries[i].size;
+
+    free(entries);
+    closedir(d);
+}
+
+/* Store in cache
+ * Input: Cache directory, key, finished output name, size bound
+ * Output: Returns e_success or e_failure (the job itself succeeded)
+ * Description:
+ * The entry is a reflink or kernel copy of the output, never a
+ * hardlink, so later writes to the output cannot reach the cache.
+ * It is made read-only and renamed into place, then the least
+ * recently used entries are evicted. An output larger than the
+ * whole bound, or not of the carrier's size, is not stored.
+ */
+Status result_cache_store(const char *dir, const ResultCacheKey *key, const char *fname, long long max_bytes)
+{
+    char name[RESULT_CACHE_ENTRY_MAX], entry[RESULT_CACHE_NAME_MAX], tmp[RESULT_CACHE_NAME_MAX];
+    struct stat st;
+    int reflinked;
+    Status ret = e_failure;
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+        return e_failure;
+
+    entry_name(name, sizeof(name), key, "");
+    snprintf(entry, sizeof(entry), "%s/%s" RESULT_CACHE_SUFFIX, dir, name);
+    snprintf(tmp, sizeof(tmp), "%s/%s.tmp.%ld", dir, name, (long)getpid());
+
+    int fd_in = open(fname, O_RDONLY);
+    if (fd_in < 0)
+        return e_failure;
+    if (fstat(fd_in, &st) != 0 || st.st_size != key->carrier_size || st.st_size > max_bytes)
+    {
+        close(fd_in);
+        return e_failure;
+    }
+
+    int fd_out = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0444);
+    if (fd_out >= 0 && io_clone_file(fd_in, fd_out, st.st_size, &reflinked) == e_success)
+        ret = e_success;
+    if (fd_out >= 0 && close(fd_out) != 0)
+        ret = e_failure;
+    close(fd_in);
+
+    if (ret == e_success && rename(tmp, entry) != 0)
+        ret = e_failure;
+    if (ret != e_success)
+    {
+        unlink(tmp);
+        return e_failure;
+    }
+
+    evict_entries(dir, max_bytes);
+    return e_success;
+}
@@ -0,0 +1,66 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include "types.h" // Contains user defined types
+#include "sha256.h" // Content digest
+
+/*
+ * On-disk cache of finished stego images (--cache=DIR).
+ *
+ * An encode job is keyed by a SHA-256 digest of the contents of the
+ * carrier and of the secret and of every parameter that changes the
+ * output bytes, so inputs crafted to collide cannot be served another
+ * job's image. A lookup reads both inputs once, sequentially, but
+ * neither embeds nor writes the carrier; the same bytes under another
+ * name hit, and any rewrite of an input misses, whatever the
+ * filesystem's timestamp granularity.
+ *
+ * Each entry is one read-only file "<digest>-<carrier size>-<secret
+ * size>.stg" in the directory. The stego image keeps the size of its
+ * carrier, so an entry of any other size is never served. A hit is
+ * served into the output by reflink, else by a kernel copy
+ * (never a hardlink, so the output stays a private writable file),
+ * and is renamed into place. Entry mtimes are the LRU clock: a hit
+ * touches its entry, and after each store the oldest entries are
+ * removed until the directory fits in --cache-max bytes.
+ */
+
+#define RESULT_CACHE_DEFAULT_MAX (1024LL * 1024 * 1024)
+#define RESULT_CACHE_SUFFIX ".stg"
+#define RESULT_CACHE_NAME_MAX 1100
+#define RESULT_CACHE_HASH_BLOCK (1024 * 1024)
+#define RESULT_CACHE_ENTRY_MAX 128
+
+/* Bump when the key derivation or the output of identical inputs changes */
+#define RESULT_CACHE_VERSION 3
+
+/* Key of one encode job */
+typedef struct _ResultCacheKey
+{
+    unsigned char digest[SHA256_DIGEST_SIZE];
+    long long carrier_size;     /* 0 when the job has no key */
+    long long secret_size;
+} ResultCacheKey;
+
+typedef enum
+{
+    e_cache_reflink,
+    e_cache_copy
+} CacheServe;
+
+
+/* Result cache function prototype */
+
+/* Key for the carrier and secret contents and params bytes; e_failure if unreadable */
+Status result_cache_key(const char *carrier_fname, const char *secret_fname, const void *params, long len, ResultCacheKey *key);
+
+/* Put the entry for key into out_fname; e_failure on a miss */
+Status result_cache_serve(const char *dir, const ResultCacheKey *key, const char *out_fname, CacheServe *how);
+
+/* Add a finished output under key, then evict down to max_bytes */
+Status result_cache_store(const char *dir, const ResultCacheKey *key, const char *fname, long long max_bytes);
+
+/* Name of a serve method */
+const char *result_cache_serve_name(CacheServe how);
+
+#endif
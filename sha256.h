@@ -0,0 +1,38 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * SHA-256 (FIPS 180-4), streaming.
+ *
+ * Used where a hash names content that must not collide, even for
+ * inputs chosen to collide (the --cache key); table and checkpoint
+ * hashes that are always confirmed by a byte compare stay cheap.
+ */
+
+#define SHA256_DIGEST_SIZE 32
+#define SHA256_BLOCK_SIZE 64
+
+typedef struct _Sha256
+{
+    uint state[8];
+    unsigned long long length;                 /* Bytes hashed so far */
+    unsigned char block[SHA256_BLOCK_SIZE];    /* Partial block */
+    int used;                                  /* Bytes in block */
+} Sha256;
+
+
+/* SHA-256 function prototype */
+
+/* Start a digest */
+void sha256_init(Sha256 *ctx);
+
+/* Hash len more bytes */
+void sha256_update(Sha256 *ctx, const void *data, size_t len);
+
+/* Finish the digest into digest[SHA256_DIGEST_SIZE] */
+void sha256_final(Sha256 *ctx, unsigned char *digest);
+
+#endif
@@ -0,0 +1,324 @@
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include "stego_header.h"
+#include "ecc.h"
+#include "matrix.h"
+#include "decode.h"
+#include "common.h"
+#include "types.h"
+
+/* Function Definitions */
+
+/* Put varint
+ * Input: Output buffer and value
+ * Output: Number of bytes written
+ * Description: Little-endian base 128, 7 bits per byte, top bit
+ * set on every byte except the last.
+ */
+int put_varint(unsigned char *buf, unsigned long long v)
+{
+    int n = 0;
+    while (v >= 0x80)
+    {
+        buf[n++] = (v & 0x7f) | 0x80;
+        v >>= 7;
+    }
+    buf[n++] = v;
+    return n;
+}
+
+/* Get varint
+ * Input: Buffer, bytes available, pointer to result
+ * Output: Bytes consumed, 0 if truncated or longer than 10 bytes
+ */
+int get_varint(const unsigned char *buf, long avail, unsigned long long *v)
+{
+    *v = 0;
+    for (int i = 0; i < avail && i < 10; i++)
+    {
+        *v |= (unsigned long long)(buf[i] & 0x7f) << (7 * i);
+        if (!(buf[i] & 0x80))
+            return i + 1;
+    }
+    return 0;
+}
+
+/* CRC-8, polynomial x^8 + x^2 + x + 1 */
+unsigned char stego_header_crc8(const unsigned char *buf, int len)
+{
+    unsigned char crc = 0;
+    for (int i = 0; i < len; i++)
+    {
+        crc ^= buf[i];
+        for (int b = 0; b < 8; b++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+/* Store a 32-bit value most significant byte first (legacy layout) */
+static void put_be32(unsigned char *buf, unsigned long v)
+{
+    for (int i = 0; i < 4; i++)
+        buf[i] = v >> (24 - 8 * i);
+}
+
+static unsigned long get_be32(const unsigned char *buf)
+{
+    return ((unsigned long)buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3];
+}
+
+/* Build stego header
+ * Input: Header fields (version, flags, extension, file size), buffer
+ *        of at least STEGO_HEADER_MAX bytes
+ * Output: Header length in bytes, also stored in hdr->length
+ * Description: Serialises the header exactly as it is embedded.
+ */
+uint build_stego_header(StegoHeader *hdr, unsigned char *buf)
+{
+    int magic_len = strlen(MAGIC_STRING);
+    int extn_len = strlen(hdr->extn_secret_file);
+    uint n = 0;
+
+    hdr->size_secret_file_extn = extn_len;
+    memcpy(buf, MAGIC_STRING, magic_len);
+    n += magic_len;
+
+    if (hdr->version == STEGO_HEADER_V1)
+    {
+        // 32-bit size field: larger secrets need the v2 header
+        if ((unsigned long)hdr->size_secret_file > 0xFFFFFFFFul)
+            return 0;
+        put_be32(buf + n, extn_len);
+        n += 4;
+        memcpy(buf + n, hdr->extn_secret_file, extn_len);
+        n += extn_len;
+        put_be32(buf + n, hdr->size_secret_file);
+        n += 4;
+    }
+    else
+    {
+        buf[n++] = STEGO_HEADER_V2;
+        buf[n++] = hdr->flags;
+        if (hdr->flags & STEGO_FLAG_ECC)
+            buf[n++] = hdr->ecc_nsym;
+        if (hdr->flags & STEGO_FLAG_DEDUP)
+            n += put_varint(buf + n, hdr->dedup_size);
+        n += put_varint(buf + n, extn_len);
+        memcpy(buf + n, hdr->extn_secret_file, extn_len);
+        n += extn_len;
+        n += put_varint(buf + n, hdr->size_secret_file);
+        buf[n] = stego_header_crc8(buf, n);
+        n++;
+
+        // Protected header: pad and append parity as one codeword
+        if (hdr->flags & STEGO_FLAG_ECC)
+        {
+            unsigned char data[ECC_HEADER_DATA] = {0};
+            if (n > ECC_HEADER_DATA)
+                return 0;
+            memcpy(data, buf, n);
+            if (rs_encode_interleaved(data, ECC_HEADER_DATA, ECC_HEADER_PARITY, buf) != e_success)
+                return 0;
+            n = ECC_HEADER_DATA + ECC_HEADER_PARITY;
+        }
+    }
+
+    hdr->length = n;
+    return n;
+}
+
+/* Parse stego header
+ * Input: Decoded header bytes, how many are valid, header to fill
+ * Output: Returns e_success or e_failure
+ * Description:
+ * Checks the magic, then parses a legacy or compact header. Every
+ * length is checked against avail before use, so a corrupt or
+ * short block can never make the parser read past it. On failure
+ * hdr->error says why; nothing is printed, callers may retry.
+ */
+Status parse_stego_header(const unsigned char *buf, int avail, StegoHeader *hdr)
+{
+    int magic_len = strlen(MAGIC_STRING);
+    int n = magic_len;
+    unsigned long long extn_len, size;
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->error = "truncated or invalid header field";
+    if (avail < magic_len + 1 || memcmp(buf, MAGIC_STRING, magic_len) != 0)
+    {
+        hdr->error = "magic string mismatch";
+        return e_failure;
+    }
+
+    if (buf[n] == 0)
+    {
+        // Legacy: 32-bit extension size whose high byte is always 0
+        hdr->version = STEGO_HEADER_V1;
+        if (avail < n + 4)
+            return e_failure;
+        extn_len = get_be32(buf + n);
+        n += 4;
+        if (extn_len == 0 || extn_len >= MAX_FILE_SUFFIX_ || avail < n + (int)extn_len + 4)
+            return e_failure;
+        memcpy(hdr->extn_secret_file, buf + n, extn_len);
+        n += extn_len;
+        size = get_be32(buf + n);
+        n += 4;
+    }
+    else
+    {
+        hdr->version = buf[n++];
+        if (hdr->version != STEGO_HEADER_V2 || avail < n + 1)
+        {
+            hdr->error = "unsupported header version";
+            return e_failure;
+        }
+
+        hdr->flags = buf[n++];
+        // k only with matrix embedding, which has no alpha variant
+        uint k = STEGO_MATRIX_K(hdr->flags);
+        if ((hdr->flags & ~STEGO_FLAGS_KNOWN) ||
+            ((hdr->flags & STEGO_FLAG_MATRIX) ? !matrix_k_supported(k) || (hdr->flags & STEGO_FLAG_ALPHA) : k != 0))
+        {
+            hdr->error = "unsupported header flags";
+            return e_failure;
+        }
+
+        if (hdr->flags & STEGO_FLAG_ECC)
+        {
+            if (avail < n + 1)
+                return e_failure;
+            hdr->ecc_nsym = buf[n++];
+            if (hdr->ecc_nsym < 2 || hdr->ecc_nsym > ECC_MAX_NSYM)
+                return e_failure;
+        }
+
+        if (hdr->flags & STEGO_FLAG_DEDUP)
+        {
+            int used = get_varint(buf + n, avail - n, &size);
+            if (used == 0 || size == 0 || size > (unsigned long long)LONG_MAX)
+                return e_failure;
+            hdr->dedup_size = size;
+            n += used;
+        }
+
+        int used = get_varint(buf + n, avail - n, &extn_len);
+        if (used == 0 || extn_len == 0 || extn_len >= MAX_FILE_SUFFIX_ || avail < n + used + (int)extn_len)
+            return e_failure;
+        n += used;
+        memcpy(hdr->extn_secret_file, buf + n, extn_len);
+        n += extn_len;
+
+        used = get_varint(buf + n, avail - n, &size);
+        if (used == 0 || avail < n + used + 1 || size > (unsigned long long)LONG_MAX)
+            return e_failure;
+        n += used;
+
+        if (stego_header_crc8(buf, n) != buf[n])
+        {
+            hdr->error = "header checksum mismatch";
+            return e_failure;
+        }
+        n++;
+    }
+
+    hdr->extn_secret_file[extn_len] = '\0';
+    hdr->size_secret_file_extn = extn_len;
+    hdr->size_secret_file = size;
+    hdr->length = n;
+    return e_success;
+}
+
+/* Payload span
+ * Input: Header flags
+ * Output: Carrier bytes per embedded byte (8 for LSB, 4 for alpha,
+ *         12 or 30 for matrix embedding)
+ */
+uint stego_payload_span(uint flags)
+{
+    if (flags & STEGO_FLAG_MATRIX)
+        return matrix_span(STEGO_MATRIX_K(flags));
+    return (flags & STEGO_FLAG_ALPHA) ? STEGO_ALPHA_SPAN : STEGO_LSB_SPAN;
+}
+
+/* The header itself is always plain LSB (or alpha) bytes */
+uint stego_header_layout(uint flags)
+{
+    return flags & ~(STEGO_FLAG_MATRIX | STEGO_MATRIX_K_MASK);
+}
+
+/* Parse a plain header, or repair it through RS if that fails or it is protected */
+static Status parse_header_block(const unsigned char *header, int avail, StegoHeader *hdr, long *corrected)
+{
+    *corrected = 0;
+    if (parse_stego_header(header, avail, hdr) == e_success && !(hdr->flags & STEGO_FLAG_ECC))
+        return e_success;
+
+    unsigned char stored[STEGO_HEADER_MAX];
+    unsigned char data[ECC_HEADER_DATA];
+    const char *plain_error = hdr->error;
+
+    if (avail < STEGO_HEADER_MAX)
+        return e_failure;
+    memcpy(stored, header, STEGO_HEADER_MAX);
+    if (rs_decode_interleaved(stored, ECC_HEADER_DATA, ECC_HEADER_PARITY, data, corrected) != e_success ||
+        parse_stego_header(data, ECC_HEADER_DATA, hdr) != e_success || !(hdr->flags & STEGO_FLAG_ECC))
+    {
+        hdr->error = plain_error;
+        return e_failure;
+    }
+
+    hdr->length = STEGO_HEADER_MAX;
+    return e_success;
+}
+
+/* Read stego header
+ * Input: Stego image, offset of its pixel data, header to fill
+ * Output: Returns e_success or e_failure
+ * Description:
+ * One pread() of up to STEGO_HEADER_MAX * 8 pixel bytes replaces
+ * the per-field reads. The header is looked for in the LSBs of the
+ * block, then in its alpha bytes. The stream is left positioned at
+ * the start of the secret data.
+ */
+Status read_stego_header(FILE *fptr_stego, long pixel_offset, StegoHeader *hdr)
+{
+    unsigned char block[STEGO_HEADER_MAX * 8];
+    unsigned char header[STEGO_HEADER_MAX];
+    long corrected;
+
+    ssize_t got = pread(fileno(fptr_stego), block, sizeof(block), pixel_offset);
+    if (got < 0)
+    {
+        perror("pread");
+        return e_failure;
+    }
+
+    int avail = got / STEGO_LSB_SPAN;
+    decode_chunk_from_lsb(header, avail, block);
+
+    // A header claiming the alpha layout in the LSBs is not one
+    if (parse_header_block(header, avail, hdr, &corrected) != e_success || (hdr->flags & STEGO_FLAG_ALPHA))
+    {
+        const char *lsb_error = hdr->error;
+
+        avail = got / STEGO_ALPHA_SPAN < STEGO_HEADER_MAX ? got / STEGO_ALPHA_SPAN : STEGO_HEADER_MAX;
+        decode_chunk_from_alpha(header, avail, block);
+        if (parse_header_block(header, avail, hdr, &corrected) != e_success || !(hdr->flags & STEGO_FLAG_ALPHA))
+        {
+            printf("\033[1;36m❌ ERROR: Header: %s\033[0m\n", lsb_error);
+            return e_failure;
+        }
+    }
+
+    if (corrected > 0)
+        printf("\033[1;36m🩹 Header repaired by ECC: %ld bytes corrected\033[0m\n", corrected);
+
+    // Continue reading the payload through the stream
+    if (fseek(fptr_stego, pixel_offset + (long)hdr->length * stego_payload_span(stego_header_layout(hdr->flags)), SEEK_SET) != 0)
+        return e_failure;
+    return e_success;
+}
@@ -0,0 +1,113 @@
+#ifndef STEGO_HEADER_H
+#define STEGO_HEADER_H
+
+#include <stdio.h>
+#include "types.h"  // Contains user defined types
+#include "decode.h" // For MAX_FILE_SUFFIX_
+
+/*
+ * Embedded header, stored in the LSBs right after the BMP header.
+ *
+ * Version 1 (legacy): magic, 32-bit extension size, extension,
+ * 32-bit file size, each field read separately.
+ *
+ * Version 2 (compact):
+ *   magic "#*" | version | flags | [flag parameters] |
+ *   varint extn size | extension | varint file size |
+ *   CRC-8 of all previous header bytes
+ *
+ * With STEGO_FLAG_ECC the flag parameter is the parity byte count
+ * of the payload codewords, and the header itself is padded to
+ * ECC_HEADER_DATA bytes and stored as one Reed-Solomon codeword of
+ * STEGO_HEADER_MAX bytes, so it survives flipped bits too.
+ *
+ * With STEGO_FLAG_DEDUP a varint flag parameter (after the parity
+ * byte count) is the size of the deduplicated container that is
+ * embedded in place of the secret (before ECC parity).
+ *
+ * With STEGO_FLAG_MATRIX the high nibble of the flags is the
+ * Hamming parameter k and the payload (not the header) is matrix
+ * embedded, matrix_span(k) carrier bytes per byte.
+ *
+ * With STEGO_FLAG_ALPHA every header and payload byte is stored
+ * whole in the 4th byte of a 4-byte pixel (alpha of BGRA / RGBA),
+ * one byte per STEGO_ALPHA_SPAN carrier bytes, colour bytes are
+ * left alone. The decoder tries the LSB layout first, then the
+ * alpha bytes of the same block.
+ *
+ * Both fit in STEGO_HEADER_MAX bytes, so a decoder fetches one
+ * bounded block of STEGO_HEADER_MAX * 8 pixel bytes with a single
+ * positioned read and parses either version from memory. Version 1
+ * has a zero byte after the magic (high byte of the extension
+ * size), version 2 never does, which tells them apart.
+ */
+
+#define STEGO_HEADER_V1 1
+#define STEGO_HEADER_V2 2
+#define STEGO_HEADER_MAX 96
+
+/* Offset of pixel data in the BMP files we handle */
+#define BMP_HEADER_SIZE 54
+
+/* Header flags, unknown bits are rejected */
+#define STEGO_FLAG_ECC 0x01u    /* Reed-Solomon protected header and payload */
+#define STEGO_FLAG_ALPHA 0x02u  /* Whole bytes in the alpha byte of 4-byte pixels */
+#define STEGO_FLAG_MATRIX 0x04u /* Payload by Hamming matrix embedding */
+#define STEGO_FLAG_DEDUP 0x08u  /* Payload is a chunk-deduplicated container */
+#define STEGO_MATRIX_K_SHIFT 4
+#define STEGO_MATRIX_K_MASK 0xF0u
+#define STEGO_FLAGS_KNOWN (STEGO_FLAG_ECC | STEGO_FLAG_ALPHA | STEGO_FLAG_MATRIX | STEGO_FLAG_DEDUP | STEGO_MATRIX_K_MASK)
+
+/* Hamming parameter k of matrix-embedded header flags */
+#define STEGO_MATRIX_K(flags) (((flags) & STEGO_MATRIX_K_MASK) >> STEGO_MATRIX_K_SHIFT)
+
+/* Carrier bytes per embedded byte */
+#define STEGO_LSB_SPAN 8
+#define STEGO_ALPHA_SPAN 4
+#define STEGO_MAX_SPAN 30       /* Matrix embedding with k = 4 */
+
+typedef struct _StegoHeader
+{
+    uint version;
+    uint flags;
+    uint ecc_nsym;
+    long dedup_size;            /* Embedded container bytes (STEGO_FLAG_DEDUP) */
+    char extn_secret_file[MAX_FILE_SUFFIX_];
+    long size_secret_file_extn;
+    long size_secret_file;
+
+    /* Header bytes as embedded, data starts at 8 * length pixel bytes */
+    uint length;
+
+    /* Reason for the last parse failure */
+    const char *error;
+} StegoHeader;
+
+
+/* Header function prototype */
+
+/* Write v as a LEB128 varint, returns bytes written (max 10) */
+int put_varint(unsigned char *buf, unsigned long long v);
+
+/* Read a varint from at most avail bytes (containers may pass 2 GiB), returns bytes used or 0 */
+int get_varint(const unsigned char *buf, long avail, unsigned long long *v);
+
+/* CRC-8 (poly 0x07) used to validate the compact header */
+unsigned char stego_header_crc8(const unsigned char *buf, int len);
+
+/* Serialise a header (version 1 or 2), returns its length in bytes, 0 if it does not fit */
+uint build_stego_header(StegoHeader *hdr, unsigned char *buf);
+
+/* Parse and validate a header of either version from memory */
+Status parse_stego_header(const unsigned char *buf, int avail, StegoHeader *hdr);
+
+/* Carrier bytes holding one embedded byte for these header flags */
+uint stego_payload_span(uint flags);
+
+/* Flags describing the header's own layout (no matrix embedding) */
+uint stego_header_layout(uint flags);
+
+/* Fetch the header block with one positioned read and parse it */
+Status read_stego_header(FILE *fptr_stego, long pixel_offset, StegoHeader *hdr);
+
+#endif
@@ -11,14 +11,19 @@
 #include "types.h"
 #include <string.h>
 #include "decode.h"
+#include "carrier_index.h"
+#include "daemon.h"
+#include "bitplane.h"
+#include "analyze.h"
+#include "metrics.h"
 
 int main(int argc , char *argv[])
 {
     // Structure to hold encoding related info
-    EncodeInfo encInfo;     
+    EncodeInfo encInfo = {0};     
 
     // Structure to hold decoding related info
-    DecodeInfo decInfo;     
+    DecodeInfo decInfo = {0};     
 
     // Check operation type from argv
     OperationType op_type = check_operation_type(argv);
@@ -29,9 +34,9 @@ int main(int argc , char *argv[])
             do_encoding(&encInfo);  // Perform encoding
 
             // Close all opened files after encoding
-            fclose(encInfo.fptr_src_image);
-            fclose(encInfo.fptr_secret);
-            fclose(encInfo.fptr_stego_image);
+            if (encInfo.fptr_src_image) fclose(encInfo.fptr_src_image);
+            if (encInfo.fptr_secret) fclose(encInfo.fptr_secret);
+            if (encInfo.fptr_stego_image) fclose(encInfo.fptr_stego_image);
         }
         else
         {
@@ -46,8 +51,8 @@ int main(int argc , char *argv[])
             do_decoding(&decInfo);  // Perform decoding
 
             // Close all opened files after encoding
-            fclose(decInfo.fptr_stego_image);
-            fclose(decInfo.fptr_secret);
+            if (decInfo.fptr_stego_image) fclose(decInfo.fptr_stego_image);
+            if (decInfo.fptr_secret) fclose(decInfo.fptr_secret);
         }
         else
         {
@@ -55,6 +60,34 @@ int main(int argc , char *argv[])
             return 0;
         }
     }
+    else if(op_type == e_index)
+    {
+        do_indexing(argc, argv);    // Build or refresh carrier index
+    }
+    else if(op_type == e_plan)
+    {
+        do_planning(argc, argv);    // Assign secrets to carriers
+    }
+    else if(op_type == e_daemon)
+    {
+        do_daemon(argc, argv);      // Serve jobs over a Unix socket
+    }
+    else if(op_type == e_client)
+    {
+        do_daemon_client(argc, argv);   // Send one job to a running daemon
+    }
+    else if(op_type == e_watermark)
+    {
+        do_watermark(argc, argv);   // Stamp one secret into many carriers
+    }
+    else if(op_type == e_analyze)
+    {
+        do_analysis(argc, argv);    // Screen images for LSB embedding
+    }
+    else if(op_type == e_metrics)
+    {
+        do_metrics(argc, argv);     // Compare carrier and stego image
+    }
     else 
     {
         printf("Unsupported\n");
@@ -69,6 +102,20 @@ OperationType check_operation_type(char *argv[])
         return e_encode;        // Encode operation selected
     else if(strcmp(argv[1],"-d") == 0) 
         return e_decode;        // Decode operation selected
+    else if(strcmp(argv[1],"-i") == 0)
+        return e_index;         // Carrier index operation selected
+    else if(strcmp(argv[1],"-p") == 0)
+        return e_plan;          // Carrier planning operation selected
+    else if(strcmp(argv[1],"-s") == 0)
+        return e_daemon;        // Daemon operation selected
+    else if(strcmp(argv[1],"-c") == 0)
+        return e_client;        // Daemon client operation selected
+    else if(strcmp(argv[1],"-w") == 0)
+        return e_watermark;     // Watermark operation selected
+    else if(strcmp(argv[1],"-a") == 0)
+        return e_analyze;       // Steganalysis operation selected
+    else if(strcmp(argv[1],"-m") == 0)
+        return e_metrics;       // Image quality metrics selected
     else
         return e_unsupported;   // Unsupported operation
 }
\ No newline at end of file
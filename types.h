@@ -15,6 +15,13 @@ typedef enum
 {
     e_encode,
     e_decode,
+    e_index,
+    e_plan,
+    e_daemon,
+    e_client,
+    e_watermark,
+    e_analyze,
+    e_metrics,
     e_unsupported
 } OperationType;
 